@@ -0,0 +1,97 @@
+// check that walking commits and config through the borrowed views does
+// not allocate. operator new is counted while the loops run; libgit2
+// allocates with malloc, so only the wrappers are measured.
+//
+//   ./alloc_check [<repository>]
+//
+// exits 1 if a loop allocated.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "gitpp5.h"
+
+using namespace std;
+using namespace GITPP;
+
+static atomic<bool> counting(false);
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t n)
+{
+	if (counting) {
+		++allocations;
+	} else {
+	}
+	if (void* p = malloc(n ? n : 1)) {
+		return p;
+	} else { untested();
+		throw bad_alloc();
+	}
+}
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+// allocations in f
+template<class F>
+static size_t count(F f)
+{
+	allocations = 0;
+	counting = true;
+	f();
+	counting = false;
+	return allocations;
+}
+
+int main(int argc, char const* argv[])
+{
+	if (argc > 2) {
+		cerr << "usage: " << argv[0] << " [<repository>]\n";
+		return 2;
+	} else {
+	}
+
+	bool bad = false;
+	try {
+		REPO r(argc > 1 ? argv[1] : ".");
+
+		// what the loops see, so that they are not optimised away
+		size_t commits = 0;
+		size_t bytes = 0;
+		auto cs = r.commits();
+		size_t n = count([&] {
+			for (auto c : cs) {
+				OID id = c.oid();
+				SIGNATURE_VIEW s = c.signature_view();
+				bytes += id.get().id[0] + c.author_view().size() + s.email().size()
+					+ c.message_view().line().size() + size_t(s.seconds() & 1);
+				++commits;
+			}
+		});
+		cout << "commits: " << commits << " walked, " << bytes << " bytes seen, "
+			<< n << " allocations\n";
+		bad = bad || n;
+
+		size_t items = 0;
+		bytes = 0;
+		auto cfg = r.config();
+		n = count([&] {
+			for (auto i : cfg) {
+				bytes += i.name_view().size() + i.value_view().size();
+				++items;
+			}
+		});
+		cout << "config: " << items << " items, " << bytes << " bytes seen, "
+			<< n << " allocations\n";
+		bad = bad || n;
+	}
+	catch (EXCEPTION const& e) {
+		cerr << e.what() << "\n";
+		return 2;
+	}
+
+	return bad ? 1 : 0;
+}
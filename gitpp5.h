@@ -22,6 +22,30 @@
  *
  * gitpp5
  * - remove bogus trace.h include.
+ * - REPO::stats(), object store statistics
+ * - POOL, run loops on all cores. POOL_REPOS, a repository handle per worker
+ * - STATUS, working tree status. INOTIFY, change notification
+ * - NOTIFY, watch HEAD, refs, config and index
+ * - POOL::run_tasks, work stealing. SEMAPHORE. REPO::dirty()
+ * - REPO::commits(range), COMMIT::seconds()
+ * - WRITER, buffered output. EXPORT, stream the log as NDJSON or binary
+ * - STRING_VIEW, SIGNATURE_VIEW and *_view() accessors, OID
+ * - COMMIT releases the git_commit
+ * - PROFILE, libgit2 cache and mwindow tuning
+ * - PREFETCH, pack readahead
+ * - OID_INDEX, shortest unique abbreviations. REPO::resolve()
+ * - TAGS, TAG, peeled from packed-refs. REPO::commit_id()
+ * - REFLOG, mapped, read from the end
+ * - GREP, search a tree in parallel
+ * - BLOB_READER, lines of a file in bounded memory
+ * - LARGEST_BLOBS. COMMIT::tree_id()
+ * - WALK_SPEC, COMMITS filters and limits
+ * - VIEW_STORE, rendered views kept between runs
+ * - HOTSPOTS, churn per path
+ * - ACTIVITY, commits per day, week and hour of the week
+ * - CLONE, local, hardlinked, parallel checkout
+ * - REPACK, loose objects into a pack. PROFILE hci.autoPack
+ * - STAGE, add to the index, hashing in parallel
  */
 
 #include <git2/repository.h>
@@ -31,16 +55,54 @@
 #include <git2/revwalk.h>
 #include <git2/revparse.h>
 #include <git2/object.h>
+#include <git2/blob.h>
 #include <git2/commit.h>
 #include <git2/branch.h>
 #include <git2/config.h>
 #include <git2/refs.h>
 #include <git2/checkout.h>
+#include <git2/clone.h>
 #include <git2/signature.h>
 #include <git2/index.h>
+#include <git2/odb.h>
+#include <git2/pack.h>
+#include <git2/status.h>
+#include <git2/tag.h>
+#include <git2/tree.h>
+#include <git2/diff.h>
+#include <git2/graph.h>
+#include <git2/patch.h>
 
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <stack>
 #include <string> // std::to_string
+#include <unordered_map>
+#include <thread>
 #include <vector> // std::to_string
 
 #define untested()
@@ -82,6 +144,585 @@ namespace GITPP {
 				EXCEPTION("invalid "+ s) {}
 	};
 
+	// run a loop on all cores. f(i, w) is called once for each i in [0, n),
+	// w < size() is the worker number, use it to index per thread state.
+	class POOL {
+		public:
+			explicit POOL(unsigned n = 0) : _n(n) {
+				if (!_n) {
+					_n = std::thread::hardware_concurrency();
+				} else {
+				}
+				if (!_n) { untested();
+					_n = 1;
+				} else {
+				}
+			}
+
+		public:
+			unsigned size() const { return _n; }
+
+			template<class F>
+			void run(size_t n, F f) {
+				std::atomic<size_t> next(0);
+				std::exception_ptr err;
+				std::mutex m;
+				auto body = [&](unsigned w) {
+					try {
+						for (size_t i; (i = next++) < n; ) {
+							f(i, w);
+						}
+					} catch (...) { untested();
+						std::lock_guard<std::mutex> l(m);
+						err = std::current_exception();
+						next = n;
+					}
+				};
+
+				std::vector<std::thread> t;
+				for (unsigned w = 1; w < _n && w < n; ++w) {
+					t.emplace_back(body, w);
+				}
+				body(0);
+				for (auto& i : t) {
+					i.join();
+				}
+
+				if (err) { untested();
+					std::rethrow_exception(err);
+				} else {
+				}
+			}
+
+			// work stealing. f(t, w, push) is called once for each seed and for
+			// each task passed to push(t), which f may call to spawn more work.
+			// a worker takes its own tasks newest first and steals the oldest
+			// from the others when it runs dry. with nothing to steal, it
+			// sleeps until a task is pushed or all are done.
+			template<class T, class F>
+			void run_tasks(std::vector<T> const& seeds, F f) {
+				struct QUEUE {
+					std::mutex m;
+					std::deque<T> q;
+				};
+				std::vector<QUEUE> q(_n);
+				std::atomic<size_t> pending(seeds.size()); // queued or running
+				std::atomic<size_t> queued(seeds.size());
+				std::atomic<bool> stop(false);
+				std::exception_ptr err;
+				std::mutex em;
+				std::mutex im;
+				std::condition_variable idle;
+				// after changing what idle waits for. taking im orders it
+				// before a waiter's check.
+				auto wake = [&](bool all) {
+					{
+						std::lock_guard<std::mutex> l(im);
+					}
+					if (all) {
+						idle.notify_all();
+					} else {
+						idle.notify_one();
+					}
+				};
+
+				for (size_t i = 0; i < seeds.size(); ++i) {
+					q[i % _n].q.push_back(seeds[i]);
+				}
+
+				auto body = [&](unsigned w) {
+					std::function<void(T const&)> push = [&](T const& t) {
+						++pending;
+						{
+							std::lock_guard<std::mutex> l(q[w].m);
+							q[w].q.push_back(t);
+							++queued;
+						}
+						wake(false);
+					};
+
+					while (pending && !stop) {
+						T t;
+						bool got = false;
+						{
+							std::lock_guard<std::mutex> l(q[w].m);
+							if (q[w].q.size()) {
+								t = q[w].q.back();
+								q[w].q.pop_back();
+								--queued;
+								got = true;
+							} else {
+							}
+						}
+						for (unsigned k = 1; !got && k < _n; ++k) {
+							QUEUE& v = q[(w + k) % _n];
+							std::lock_guard<std::mutex> l(v.m);
+							if (v.q.size()) {
+								t = v.q.front();
+								v.q.pop_front();
+								--queued;
+								got = true;
+							} else {
+							}
+						}
+
+						if (!got) {
+							// someone else is still busy, and may push more.
+							std::unique_lock<std::mutex> l(im);
+							idle.wait(l, [&] { return queued || !pending || stop; });
+							continue;
+						} else {
+						}
+
+						try {
+							f(t, w, push);
+						} catch (...) { untested();
+							{
+								std::lock_guard<std::mutex> l(em);
+								err = std::current_exception();
+								stop = true;
+							}
+							wake(true);
+						}
+						if (!--pending) {
+							wake(true);
+						} else {
+						}
+					}
+				};
+
+				std::vector<std::thread> t;
+				for (unsigned w = 1; w < _n; ++w) {
+					t.emplace_back(body, w);
+				}
+				body(0);
+				for (auto& i : t) {
+					i.join();
+				}
+
+				if (err) { untested();
+					std::rethrow_exception(err);
+				} else {
+				}
+			}
+
+		private:
+			unsigned _n;
+	};
+
+	// a repository handle, and its object database, for each worker of a
+	// POOL. libgit2 handles are not shared between threads. opened on first
+	// use, closed with this, also when run() throws.
+	class POOL_REPOS {
+		public:
+			POOL_REPOS(POOL const& p, std::string const& path)
+				: _path(path), _r(p.size(), nullptr), _o(p.size(), nullptr) {}
+			~POOL_REPOS() {
+				for (size_t w = 0; w < _r.size(); ++w) {
+					git_odb_free(_o[w]);
+					git_repository_free(_r[w]);
+				}
+			}
+		private:
+			POOL_REPOS(POOL_REPOS const&);
+			POOL_REPOS& operator=(POOL_REPOS const&);
+
+		public:
+			git_repository* repo(unsigned w) {
+				if (_r[w]) {
+				} else if (git_repository_open(&_r[w], _path.c_str())) { untested();
+					_r[w] = nullptr;
+					throw EXCEPTION("can't reopen repository");
+				} else {
+				}
+				return _r[w];
+			}
+			git_odb* odb(unsigned w) {
+				if (_o[w]) {
+				} else if (git_repository_odb(&_o[w], repo(w))) { untested();
+					_o[w] = nullptr;
+					throw EXCEPTION("can't open object database");
+				} else {
+				}
+				return _o[w];
+			}
+
+		private:
+			std::string _path;
+			std::vector<git_repository*> _r;
+			std::vector<git_odb*> _o;
+	};
+
+	// counting semaphore, e.g. to bound the number of open files.
+	class SEMAPHORE {
+		public:
+			explicit SEMAPHORE(size_t n) : _n(n) {}
+		public:
+			void acquire(size_t k = 1) {
+				std::unique_lock<std::mutex> l(_m);
+				_c.wait(l, [&] { return _n >= k; });
+				_n -= k;
+			}
+			void release(size_t k = 1) {
+				{
+					std::lock_guard<std::mutex> l(_m);
+					_n += k;
+				}
+				_c.notify_all();
+			}
+		private:
+			size_t _n;
+			std::mutex _m;
+			std::condition_variable _c;
+	};
+
+	// inotify wrapper. reports changed paths below watched directories,
+	// relative to the prefix given to watch().
+	class INOTIFY {
+		public:
+			INOTIFY() : _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+				if (_fd < 0) { untested();
+					throw EXCEPTION("can't initialise inotify");
+				} else {
+				}
+			}
+			~INOTIFY() {
+				close(_fd);
+			}
+		private:
+			INOTIFY(INOTIFY const&);
+
+		public:
+			enum {
+				_mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+					| IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF
+			};
+
+			// false if out of watches (see fs.inotify.max_user_watches)
+			bool watch(std::string const& dir, std::string const& prefix,
+					uint32_t mask = _mask) {
+				int wd = inotify_add_watch(_fd, dir.c_str(), mask | IN_ONLYDIR);
+				if (wd >= 0) {
+					std::lock_guard<std::mutex> l(_lock);
+					_wd[wd] = prefix;
+					return true;
+				} else if (errno == ENOENT || errno == ENOTDIR) { untested();
+					return true;
+				} else { untested();
+					return false;
+				}
+			}
+
+			// call f(path, mask) for each pending event, don't block.
+			// false if events were lost and everything must be assumed changed.
+			template<class F>
+			bool poll(F f) {
+				alignas(struct inotify_event) char buf[1 << 16];
+				bool ok = true;
+				std::lock_guard<std::mutex> l(_lock);
+
+				for (;;) {
+					ssize_t n = read(_fd, buf, sizeof(buf));
+					if (n <= 0) {
+						break;
+					} else {
+					}
+
+					for (char* p = buf; p < buf + n; ) {
+						struct inotify_event const* e = reinterpret_cast<struct inotify_event*>(p);
+						p += sizeof(struct inotify_event) + e->len;
+
+						auto w = _wd.find(e->wd);
+						if (e->mask & IN_Q_OVERFLOW) { untested();
+							ok = false;
+						} else if (w == _wd.end()) { untested();
+						} else if (e->mask & IN_IGNORED) {
+							_wd.erase(w);
+						} else if (e->len) {
+							f(w->second + e->name, e->mask);
+						} else {
+							// the directory itself
+							f(w->second, e->mask);
+						}
+					}
+				}
+
+				return ok;
+			}
+
+			// for select/poll/epoll
+			int fd() const { return _fd; }
+
+		private:
+			int _fd;
+			std::map<int, std::string> _wd;
+			std::mutex _lock; // watch() is called from POOL workers
+	};
+
+	// buffered output to a file descriptor. small things are formatted in
+	// place, into a buffer that is reused. big ones are passed to writev()
+	// along with the buffer, without a copy.
+	class WRITER {
+		public:
+			explicit WRITER(int fd, size_t size = 1 << 20)
+				: _fd(fd), _b(new char[size]), _size(size), _n(0) {}
+			~WRITER() {
+				try {
+					flush();
+				} catch (EXCEPTION const&) { untested();
+				}
+				delete[] _b;
+			}
+		private:
+			WRITER(WRITER const&);
+
+		public:
+			// room for n < size bytes, to be filled and then commit()ed.
+			char* reserve(size_t n) {
+				assert(n <= _size);
+				if (_n + n > _size) {
+					flush();
+				} else {
+				}
+				return _b + _n;
+			}
+			void commit(size_t n) {
+				_n += n;
+			}
+
+			void put(char c) {
+				*reserve(1) = c;
+				++_n;
+			}
+			void put(char const* s, size_t n) {
+				if (n < _size / 4) {
+					memcpy(reserve(n), s, n);
+					_n += n;
+				} else {
+					struct iovec v[2] = {{_b, _n}, {const_cast<char*>(s), n}};
+					writev_all(v, 2);
+					_n = 0;
+				}
+			}
+			void put(char const* s) {
+				put(s, strlen(s));
+			}
+			// the first n hex digits
+			void put_hex(git_oid const& id, unsigned n = GIT_OID_HEXSZ) {
+				git_oid_fmt(reserve(GIT_OID_HEXSZ), &id);
+				_n += n;
+			}
+			void put_raw(git_oid const& id) {
+				memcpy(reserve(GIT_OID_RAWSZ), id.id, GIT_OID_RAWSZ);
+				_n += GIT_OID_RAWSZ;
+			}
+			// decimal
+			void put_int(int64_t v) {
+				char t[24];
+				char* e = t + sizeof(t);
+				char* p = e;
+				uint64_t u = v < 0 ? -uint64_t(v) : uint64_t(v);
+				do {
+					*--p = char('0' + u % 10);
+					u /= 10;
+				} while (u);
+				if (v < 0) {
+					*--p = '-';
+				} else {
+				}
+				put(p, e - p);
+			}
+			// little endian, bytes wide
+			void put_le(uint64_t v, unsigned bytes) {
+				char* p = reserve(bytes);
+				for (unsigned i = 0; i < bytes; ++i) {
+					p[i] = char(v >> (8 * i));
+				}
+				_n += bytes;
+			}
+			// a JSON string, with quotes.
+			void put_json(char const* s, size_t n) {
+				static char const hex[] = "0123456789abcdef";
+				put('"');
+				size_t run = 0;
+				for (size_t i = 0; i < n; ++i) {
+					unsigned char c = s[i];
+					if (c >= 0x20 && c != '"' && c != '\\') {
+						continue;
+					} else {
+					}
+
+					put(s + run, i - run);
+					run = i + 1;
+					char* p = reserve(6);
+					p[0] = '\\';
+					if (c == '"' || c == '\\') {
+						p[1] = c;
+						_n += 2;
+					} else if (c == '\n') {
+						p[1] = 'n';
+						_n += 2;
+					} else if (c == '\t') {
+						p[1] = 't';
+						_n += 2;
+					} else {
+						p[1] = 'u';
+						p[2] = p[3] = '0';
+						p[4] = hex[c >> 4];
+						p[5] = hex[c & 15];
+						_n += 6;
+					}
+				}
+				put(s + run, n - run);
+				put('"');
+			}
+
+			void flush() {
+				struct iovec v = {_b, _n};
+				writev_all(&v, 1);
+				_n = 0;
+			}
+
+		private:
+			void writev_all(struct iovec* v, int n) {
+				while (n) {
+					ssize_t k = writev(_fd, v, n);
+					if (k < 0 && errno == EINTR) { untested();
+						continue;
+					} else if (k < 0) {
+						throw EXCEPTION("write error: " + std::string(strerror(errno)));
+					} else {
+					}
+					for (; n && size_t(k) >= v->iov_len; ++v, --n) {
+						k -= v->iov_len;
+					}
+					if (n) {
+						v->iov_base = static_cast<char*>(v->iov_base) + k;
+						v->iov_len -= k;
+					} else {
+					}
+				}
+			}
+
+		private:
+			int _fd;
+			char* _b;
+			size_t _size;
+			size_t _n;
+	};
+
+	// a string owned by someone else, valid as long as the owner is.
+	class STRING_VIEW {
+		public:
+			STRING_VIEW() : _p(""), _n(0) {}
+			STRING_VIEW(char const* p) : _p(p ? p : ""), _n(strlen(_p)) {}
+			STRING_VIEW(char const* p, size_t n) : _p(p), _n(n) {}
+		public:
+			char const* data() const { return _p; }
+			size_t size() const { return _n; }
+			bool empty() const { return !_n; }
+			char operator[](size_t i) const { return _p[i]; }
+			char const* begin() const { return _p; }
+			char const* end() const { return _p + _n; }
+			// up to the first newline
+			STRING_VIEW line() const {
+				char const* e = static_cast<char const*>(memchr(_p, '\n', _n));
+				return STRING_VIEW(_p, e ? e - _p : _n);
+			}
+			std::string str() const { return std::string(_p, _n); }
+
+			bool operator==(STRING_VIEW const& x) const {
+				return _n == x._n && !memcmp(_p, x._p, _n);
+			}
+			bool operator!=(STRING_VIEW const& x) const {
+				return !(*this == x);
+			}
+			bool operator<(STRING_VIEW const& x) const {
+				int c = memcmp(_p, x._p, std::min(_n, x._n));
+				return c < 0 || (!c && _n < x._n);
+			}
+		private:
+			char const* _p;
+			size_t _n;
+	};
+
+	inline std::ostream& operator<< (std::ostream& o, STRING_VIEW const& s)
+	{
+		return o.write(s.data(), s.size());
+	}
+
+	// an object id, by value. usable as a key in std::unordered_map.
+	class OID {
+		public:
+			OID() {
+				memset(&_id, 0, sizeof(_id));
+			}
+			OID(git_oid const& i) : _id(i) {}
+		public:
+			git_oid const& get() const { return _id; }
+			bool is_zero() const { return git_oid_iszero(&_id); }
+			// GIT_OID_HEXSZ characters, not terminated
+			void fmt(char* buf) const { git_oid_fmt(buf, &_id); }
+			std::string str() const {
+				char buf[GIT_OID_HEXSZ];
+				fmt(buf);
+				return std::string(buf, GIT_OID_HEXSZ);
+			}
+
+			bool operator==(OID const& x) const {
+				return !memcmp(_id.id, x._id.id, GIT_OID_RAWSZ);
+			}
+			bool operator!=(OID const& x) const {
+				return !(*this == x);
+			}
+			bool operator<(OID const& x) const {
+				return memcmp(_id.id, x._id.id, GIT_OID_RAWSZ) < 0;
+			}
+			// the id is a hash already
+			size_t hash() const {
+				size_t h;
+				memcpy(&h, _id.id, sizeof(h));
+				return h;
+			}
+		private:
+			git_oid _id;
+	};
+
+	inline std::ostream& operator<< (std::ostream& o, OID const& i)
+	{
+		char buf[GIT_OID_HEXSZ];
+		i.fmt(buf);
+		return o.write(buf, GIT_OID_HEXSZ);
+	}
+}
+
+namespace std {
+	template<>
+	struct hash<GITPP::OID> {
+		size_t operator()(GITPP::OID const& i) const {
+			return i.hash();
+		}
+	};
+}
+
+namespace GITPP {
+
+	// author or committer, borrowed from the commit.
+	class SIGNATURE_VIEW {
+		public:
+			explicit SIGNATURE_VIEW(git_signature const* s) : _s(s) {
+				assert(s);
+			}
+		public:
+			STRING_VIEW name() const { return _s->name; }
+			STRING_VIEW email() const { return _s->email; }
+			git_time_t seconds() const { return _s->when.time; }
+			// minutes east of UTC
+			int offset() const { return _s->when.offset; }
+		private:
+			git_signature const* _s;
+	};
+
 	class SIGNATURE {
 		public:
 			SIGNATURE(git_commit const* c) {
@@ -108,6 +749,15 @@ namespace GITPP {
 				} else {
 				}
 			}
+			// takes c
+			explicit COMMIT(git_commit* c): _id(*git_commit_id(c)), _c(c) {
+			}
+			COMMIT(COMMIT const& x) : _id(x._id) {
+				git_commit_dup(&_c, x._c);
+			}
+			~COMMIT() {
+				git_commit_free(_c);
+			}
 		public:
 			bool operator==(COMMIT const& x) const { untested();
 				return git_oid_equal(&_id, &x._id);
@@ -122,14 +772,42 @@ namespace GITPP {
 				return std::string(buf);
 			}
 			std::ostream& print(std::ostream& o) const {
-				return o << id();
+				return o << oid();
 			}
 			std::string author() const {
 				return signature().name();
 			}
+
+			// borrowed views, valid while this COMMIT is.
+			OID oid() const {
+				return OID(_id);
+			}
+			STRING_VIEW message_view() const {
+				return git_commit_message(_c);
+			}
+			STRING_VIEW author_view() const {
+				return signature_view().name();
+			}
+			SIGNATURE_VIEW signature_view() const {
+				return SIGNATURE_VIEW(git_commit_author(_c));
+			}
+			unsigned parents() const {
+				return git_commit_parentcount(_c);
+			}
+			OID parent(unsigned i) const {
+				return OID(*git_commit_parent_id(_c, i));
+			}
+			OID tree_id() const {
+				return OID(*git_commit_tree_id(_c));
+			}
+
 			std::string message() {
 				return git_commit_message(_c);
 			}
+			// seconds since the epoch
+			git_time_t seconds() const {
+				return git_commit_time(_c);
+			}
 			std::string time(unsigned len=99) const {
 				git_time_t seconds=git_commit_time(_c);
 
@@ -202,6 +880,15 @@ namespace GITPP {
 						assert(_entry);
 						return _entry->name;
 					}
+					// valid until the iterator moves on
+					STRING_VIEW value_view() const {
+						assert(_entry);
+						return _entry->value;
+					}
+					STRING_VIEW name_view() const {
+						assert(_entry);
+						return _entry->name;
+					}
 					std::ostream& print(std::ostream& o) const {
 						return o << name() << " = " << value();
 					}
@@ -304,6 +991,83 @@ namespace GITPP {
 		return c.print(o);
 	}
 
+	// what COMMITS walks, and which of it to keep.
+	//
+	// revisions are "A", "^A" to leave out what A reaches, or "A..B". the
+	// filters run in the walk, before a COMMIT is made, and the walk stops
+	// when max_count commits were kept, or once it is past since.
+	class WALK_SPEC {
+		public:
+			// revisions separated by spaces. none means HEAD.
+			WALK_SPEC(std::string const& revs = "HEAD")
+				: _sort(GIT_SORT_NONE), _first_parent(false), _max(0), _since(0), _until(0) {
+				size_t b = 0;
+				while ((b = revs.find_first_not_of(' ', b)) != std::string::npos) {
+					size_t e = std::min(revs.find(' ', b), revs.size());
+					std::string r = revs.substr(b, e - b);
+					if (r[0] == '^') {
+						exclude(r.substr(1));
+					} else {
+						include(r);
+					}
+					b = e;
+				}
+			}
+		public:
+			WALK_SPEC& include(std::string const& r) { _include.push_back(r); return *this; }
+			WALK_SPEC& exclude(std::string const& r) { _exclude.push_back(r); return *this; }
+			// GIT_SORT_TOPOLOGICAL, GIT_SORT_TIME, GIT_SORT_REVERSE
+			WALK_SPEC& sort(unsigned s) { _sort = s; return *this; }
+			WALK_SPEC& first_parent(bool f) { _first_parent = f; return *this; }
+			// 0 for all
+			WALK_SPEC& max_count(size_t n) { _max = n; return *this; }
+			// commit times, 0 for no limit
+			WALK_SPEC& since(git_time_t t) { _since = t; return *this; }
+			WALK_SPEC& until(git_time_t t) { _until = t; return *this; }
+			// part of the author name or email
+			WALK_SPEC& author(std::string const& a) { _author = a; return *this; }
+
+		public:
+			std::vector<std::string> const& includes() const { return _include; }
+			std::vector<std::string> const& excludes() const { return _exclude; }
+			unsigned sort() const { return _sort; }
+			bool first_parent() const { return _first_parent; }
+			size_t max_count() const { return _max; }
+			git_time_t since() const { return _since; }
+			git_time_t until() const { return _until; }
+			std::string const& author() const { return _author; }
+			// anything that needs the commit to decide
+			bool filters() const { return _since || _until || _author.size(); }
+
+			// seconds since the epoch, or YYYY-MM-DD (UTC)
+			static git_time_t parse_time(std::string const& s) {
+				struct tm tm;
+				memset(&tm, 0, sizeof(tm));
+				char* e;
+				long long t = strtoll(s.c_str(), &e, 10);
+				if (s.size() && !*e) {
+					return t;
+				} else if (s.size() == 10 && sscanf(s.c_str(), "%4d-%2d-%2d",
+							&tm.tm_year, &tm.tm_mon, &tm.tm_mday) == 3) {
+					tm.tm_year -= 1900;
+					tm.tm_mon -= 1;
+					return timegm(&tm);
+				} else {
+					throw EXCEPTION_INVALID("time " + s);
+				}
+			}
+
+		private:
+			std::vector<std::string> _include;
+			std::vector<std::string> _exclude;
+			unsigned _sort;
+			bool _first_parent;
+			size_t _max;
+			git_time_t _since;
+			git_time_t _until;
+			std::string _author;
+	};
+
 	class COMMITS {
 		public:
 			class COMMIT_WALKER {
@@ -319,7 +1083,7 @@ namespace GITPP {
 				COMMIT_WALKER& operator++() {
 					assert(!git_oid_iszero(&_id));
 
-					if (!_c->_walk || git_revwalk_next(&_id, _c->_walk)) {
+					if (!_c->next(_id)) {
 						std::fill((char*) &_id, (char*) (&_id) + sizeof(git_oid), 0);
 					} else {
 					}
@@ -339,8 +1103,12 @@ namespace GITPP {
 			};
 
 		public:
-			COMMITS(REPO& r);
+			// commits reachable from range, "A..B" or a single revision.
+			COMMITS(REPO& r, std::string const& range = "HEAD")
+				: COMMITS(r, WALK_SPEC(range)) {}
+			COMMITS(REPO& r, WALK_SPEC const& spec);
 			~COMMITS() {
+				git_commit_free(_cur);
 				git_revwalk_free(_walk);
 			}
 
@@ -355,36 +1123,293 @@ namespace GITPP {
 			COMMIT_WALKER end() {
 				return COMMIT_WALKER();
 			}
+			// the next commit the spec keeps, false at the end
+			bool next(git_oid& id);
+
+		private:
+			// an abbreviated id, and not a ref
+			bool is_abbrev(std::string const& r) const;
+			void push(std::string const& rev, bool only);
+			void hide(std::string const& rev);
 
 		private:
 			REPO& _repo;
 			git_revwalk* _walk;
+			WALK_SPEC _spec;
+			git_commit* _cur; // looked up by a filter, for operator*
+			size_t _kept;
+			unsigned _old; // commits in a row before since
+			bool _done;
+
+		public:
+			friend class EXPORT;
 	};
 
 	class BRANCHES;
+	class TAGS;
 
-	// a git repository
-	class REPO {
+	// all object ids in the repository, sorted. built from the pack indexes
+	// and the loose object directories, see REPO::oid_index().
+	//
+	// the shortest unique abbreviation of an id only depends on its
+	// neighbours, so they are all computed in one pass when the index is
+	// built, and looking one up is a bucket and a short binary search.
+	class OID_INDEX {
 		public:
-			enum create_t {
-				_create
-			};
+			explicit OID_INDEX(std::string const& objects) {
+				static char const hex[] = "0123456789abcdef";
 
-		public:
-			REPO(create_t, std::string path = ".") {
-				if (!git_repository_open(&_repo, path.c_str())) {
-					throw EXCEPTION("already there. doesn't work");
-				} else if (int err = git_repository_init(&_repo, path.c_str(), 0)) {
-					throw EXCEPTION("internal error creating repo: " + std::to_string(err));
-				} else {
+				std::string pd = objects + "pack/";
+				if (DIR* dir = opendir(pd.c_str())) {
+					while (struct dirent* e = readdir(dir)) {
+						std::string n(e->d_name);
+						if (n.size() > 4 && !n.compare(n.size() - 4, 4, ".idx")) {
+							read_idx(pd + n);
+						} else {
+						}
+					}
+					closedir(dir);
+				} else { untested();
 				}
-			}
 
-			REPO(std::string path = ".") : _repo(nullptr) {
-				git_libgit2_init();
+				for (int i = 0; i < 256; ++i) {
+					std::string d = objects + hex[i >> 4] + hex[i & 15] + "/";
+					DIR* dir = opendir(d.c_str());
+					if (!dir) {
+						continue;
+					} else {
+					}
+					while (struct dirent* e = readdir(dir)) {
+						std::string n = d.substr(d.size() - 3, 2) + e->d_name;
+						git_oid id;
+						if (n.size() == GIT_OID_HEXSZ && !git_oid_fromstr(&id, n.c_str())) {
+							_ids.push_back(id);
+						} else {
+						}
+					}
+					closedir(dir);
+				}
 
-				int error = git_repository_open(&_repo, path.c_str());
-				if (error < 0) {
+				std::sort(_ids.begin(), _ids.end());
+				_ids.erase(std::unique(_ids.begin(), _ids.end()), _ids.end());
+
+				// abbreviations
+				_len.resize(_ids.size(), 1);
+				for (size_t i = 1; i < _ids.size(); ++i) {
+					unsigned c = common(_ids[i - 1], _ids[i]) + 1;
+					_len[i - 1] = std::max<unsigned>(_len[i - 1], c);
+					_len[i] = c;
+				}
+
+				// buckets by the first 16 bits
+				_fan.assign(_buckets + 1, 0);
+				for (auto const& id : _ids) {
+					++_fan[bucket(id) + 1];
+				}
+				for (size_t b = 0; b < _buckets; ++b) {
+					_fan[b + 1] += _fan[b];
+				}
+			}
+
+		public:
+			size_t size() const { return _ids.size(); }
+
+			// hex digits needed to tell id apart from all others, at least min
+			unsigned abbrev(OID const& id, unsigned min = 7) const {
+				auto b = _ids.begin() + _fan[bucket(id)];
+				auto e = _ids.begin() + _fan[bucket(id) + 1];
+				auto i = std::lower_bound(b, e, id);
+				if (i == e || *i != id) { untested();
+					// not in the index (yet)
+					return GIT_OID_HEXSZ;
+				} else {
+					return std::max(min, unsigned(_len[i - _ids.begin()]));
+				}
+			}
+
+			// the abbreviation, as a string
+			std::string short_id(OID const& id, unsigned min = 7) const {
+				return id.str().substr(0, abbrev(id, min));
+			}
+
+			// the id starting with prefix. throws if there is none, or more.
+			OID resolve(std::string const& prefix) const {
+				git_oid p;
+				std::string h(prefix);
+				if (h.size() < 4 || h.size() > GIT_OID_HEXSZ
+						|| git_oid_fromstrn(&p, h.c_str(), h.size())) {
+					throw EXCEPTION_INVALID("object id " + prefix);
+				} else {
+				}
+
+				auto i = std::lower_bound(_ids.begin(), _ids.end(), OID(p));
+				if (i == _ids.end() || git_oid_ncmp(&i->get(), &p, h.size())) {
+					throw EXCEPTION_CANT_FIND(prefix);
+				} else if (i + 1 != _ids.end() && !git_oid_ncmp(&(i + 1)->get(), &p, h.size())) {
+					throw EXCEPTION_INVALID("ambiguous " + prefix);
+				} else {
+					return *i;
+				}
+			}
+
+		private:
+			enum { _buckets = 1 << 16 };
+			static size_t bucket(OID const& id) {
+				return (size_t(id.get().id[0]) << 8) | id.get().id[1];
+			}
+			// hex digits in common
+			static unsigned common(OID const& a, OID const& b) {
+				unsigned i = 0;
+				while (i < GIT_OID_RAWSZ && a.get().id[i] == b.get().id[i]) {
+					++i;
+				}
+				if (i == GIT_OID_RAWSZ) { untested();
+					return GIT_OID_HEXSZ;
+				} else if ((a.get().id[i] ^ b.get().id[i]) & 0xf0) {
+					return 2 * i;
+				} else {
+					return 2 * i + 1;
+				}
+			}
+
+			// version 1: fan-out, then offset and id per object.
+			// version 2: magic, version, fan-out, then the ids.
+			void read_idx(std::string const& path) {
+				int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				struct stat st;
+				if (fd < 0) { untested();
+					return;
+				} else if (fstat(fd, &st) || st.st_size < 8 + 256 * 4) { untested();
+					close(fd);
+					return;
+				} else {
+				}
+
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if (m == MAP_FAILED) { untested();
+					return;
+				} else {
+				}
+
+				unsigned char const* p = static_cast<unsigned char const*>(m);
+				bool v2 = !memcmp(p, "\377tOc", 4);
+				unsigned char const* fan = v2 ? p + 8 : p;
+				unsigned char const* last = fan + 255 * 4;
+				size_t n = (size_t(last[0]) << 24) | (size_t(last[1]) << 16)
+					| (size_t(last[2]) << 8) | last[3];
+				size_t stride = v2 ? GIT_OID_RAWSZ : 4 + GIT_OID_RAWSZ;
+				unsigned char const* ids = fan + 256 * 4 + (v2 ? 0 : 4);
+
+				if (ids + n * stride > p + st.st_size) { untested();
+					// truncated
+				} else {
+					_ids.reserve(_ids.size() + n);
+					for (size_t i = 0; i < n; ++i) {
+						git_oid id;
+						memcpy(id.id, ids + i * stride, GIT_OID_RAWSZ);
+						_ids.push_back(id);
+					}
+				}
+
+				munmap(m, st.st_size);
+			}
+
+		private:
+			std::vector<OID> _ids;
+			std::vector<unsigned char> _len;
+			std::vector<uint32_t> _fan;
+	};
+
+	// object store statistics, what "git count-objects -v" and
+	// "git verify-pack" would tell. see REPO::stats()
+	class STATS {
+		public:
+			class PACK {
+				public:
+					PACK(std::string const& n, uint64_t s, uint64_t i)
+						: _name(n), _size(s), _idx_size(i) {}
+				public:
+					std::string const& name() const { return _name; }
+					uint64_t size() const { return _size; }
+					uint64_t idx_size() const { return _idx_size; }
+				private:
+					std::string _name;
+					uint64_t _size;
+					uint64_t _idx_size;
+			};
+
+		public:
+			STATS() : _loose_count(0), _loose_size(0), _pack_size(0) {
+				std::fill(_count, _count + _types, 0);
+			}
+
+		public:
+			size_t loose_count() const { return _loose_count; }
+			uint64_t loose_size() const { return _loose_size; }
+			std::vector<PACK> const& packs() const { return _packs; }
+			uint64_t pack_size() const { return _pack_size; }
+			// distinct objects of type t (commit, tree, blob, tag)
+			size_t count(git_object_t t) const {
+				if (t > 0 && int(t) < _types) {
+					return _count[t];
+				} else { untested();
+					return 0;
+				}
+			}
+			size_t objects() const {
+				size_t n = 0;
+				for (int t = 1; t < _types; ++t) {
+					n += _count[t];
+				}
+				return n;
+			}
+			std::vector<PACK> largest(size_t n) const {
+				std::vector<PACK> p(_packs);
+				std::sort(p.begin(), p.end(), [](PACK const& a, PACK const& b) {
+					return a.size() > b.size();
+				});
+				if (p.size() > n) {
+					p.erase(p.begin() + n, p.end());
+				} else {
+				}
+				return p;
+			}
+
+		private:
+			enum { _types = GIT_OBJECT_TAG + 1 };
+			size_t _loose_count;
+			uint64_t _loose_size;
+			std::vector<PACK> _packs;
+			uint64_t _pack_size;
+			size_t _count[_types];
+
+		public:
+			friend class REPO;
+	};
+
+	// a git repository
+	class REPO {
+		public:
+			enum create_t {
+				_create
+			};
+
+		public:
+			REPO(create_t, std::string path = ".") {
+				if (!git_repository_open(&_repo, path.c_str())) {
+					throw EXCEPTION("already there. doesn't work");
+				} else if (int err = git_repository_init(&_repo, path.c_str(), 0)) {
+					throw EXCEPTION("internal error creating repo: " + std::to_string(err));
+				} else {
+				}
+			}
+
+			REPO(std::string path = ".") : _repo(nullptr) {
+				git_libgit2_init();
+
+				int error = git_repository_open(&_repo, path.c_str());
+				if (error < 0) {
 					const git_error *e = giterr_last();
 					throw EXCEPTION_CANT_FIND(
 								" repository (" + std::string(e->message) + ", "
@@ -398,14 +1423,51 @@ namespace GITPP {
 			}
 
 		public:
-			COMMITS commits() {
-				return COMMITS(*this);
+			COMMITS commits(std::string const& range = "HEAD") {
+				return COMMITS(*this, range);
+			}
+			COMMITS commits(WALK_SPEC const& spec) {
+				return COMMITS(*this, spec);
 			}
 			CONFIG config() {
 				return CONFIG(*this);
 			}
 			BRANCHES branches();
 			void checkout(std::string const&);
+			STATS stats();
+			// without build, NULL unless an up to date one is at hand
+			std::shared_ptr<OID_INDEX const> oid_index(bool build = true);
+			// full id for an abbreviated one. through the oid index if it
+			// is built, the object database otherwise.
+			OID resolve(std::string const& prefix);
+			// the commit a revision (id, ref, tag, "HEAD~2"...) stands for
+			OID commit_id(std::string const& rev);
+			TAGS tags();
+
+			// the .git directory, with trailing slash
+			std::string path() const {
+				return git_repository_path(_repo);
+			}
+			// anything to commit, or untracked files?
+			bool dirty() {
+				git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+				opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+				git_status_list* l;
+				if (git_repository_is_bare(_repo)) {
+					return false;
+				} else if (git_status_list_new(&l, _repo, &opts)) { untested();
+					throw EXCEPTION("status error: " + std::string(giterr_last()->message));
+				} else {
+					bool d = git_status_list_entrycount(l);
+					git_status_list_free(l);
+					return d;
+				}
+			}
+			// the working tree, with trailing slash. empty if bare.
+			std::string workdir() const {
+				char const* w = git_repository_workdir(_repo);
+				return w ? w : "";
+			}
 
 		private:
 			git_repository* _repo;
@@ -414,6 +1476,15 @@ namespace GITPP {
 			friend class COMMITS;
 			friend class CONFIG;
 			friend class BRANCHES;
+			friend class STATUS;
+			friend class EXPORT;
+			friend class TAGS;
+			friend class GREP;
+			friend class BLOB_READER;
+			friend class VIEW_STORE;
+			friend class ACTIVITY;
+			friend class REPACK;
+			friend class STAGE;
 	};
 
 	COMMIT COMMITS::create(std::string const& msg)
@@ -471,10 +1542,17 @@ namespace GITPP {
 
 		public:
 			std::string name() const {
+				return name_view().str();
+			}
+			// valid while the reference is
+			STRING_VIEW name_view() const {
 				const char* c;
 				git_branch_name(&c, _ref);
 				assert(c);
-				return std::string(c);
+				return c;
+			}
+			bool is_head() const {
+				return git_branch_is_head(_ref) == 1;
 			}
 			std::ostream& print(std::ostream& o) const {
 				return o << name();
@@ -598,77 +1676,3705 @@ namespace GITPP {
 			REPO& _repo;
 	};
 
-	inline BRANCHES REPO::branches()
+	// working tree status, modified, staged and untracked files.
+	//
+	// the working tree is compared against the index stat data on all cores,
+	// one directory per task. only the paths that look dirty are then passed
+	// to git_status_list_new. with watch, inotify keeps a set of paths that
+	// changed since, and refresh() only rechecks those, and the paths whose
+	// index entries changed when the index was written.
+	class STATUS {
+		public:
+			class ENTRY {
+				public:
+					ENTRY(std::string const& p, unsigned f) : _path(p), _flags(f) {}
+				public:
+					std::string const& path() const { return _path; }
+					unsigned flags() const { return _flags; }
+					bool staged() const {
+						return _flags & (GIT_STATUS_INDEX_NEW | GIT_STATUS_INDEX_MODIFIED
+								| GIT_STATUS_INDEX_DELETED | GIT_STATUS_INDEX_RENAMED
+								| GIT_STATUS_INDEX_TYPECHANGE);
+					}
+					bool modified() const {
+						return _flags & (GIT_STATUS_WT_MODIFIED | GIT_STATUS_WT_DELETED
+								| GIT_STATUS_WT_TYPECHANGE | GIT_STATUS_WT_RENAMED);
+					}
+					bool untracked() const {
+						return _flags & GIT_STATUS_WT_NEW;
+					}
+					std::ostream& print(std::ostream& o) const {
+						o << (staged() ? 'S' : ' ');
+						o << (modified() ? 'M' : untracked() ? '?' : ' ');
+						return o << ' ' << _path;
+					}
+				private:
+					std::string _path;
+					unsigned _flags;
+			};
+
+		public:
+			explicit STATUS(REPO& r, bool watch = false)
+				: _repo(r), _full(true), _index(true) {
+				if (!watch) {
+				} else if (r.workdir() == "") { untested();
+				} else {
+					try {
+						_watch.reset(new INOTIFY);
+					}
+					catch (EXCEPTION const&) { untested();
+						// out of inotify instances, scan every time.
+					}
+				}
+				refresh();
+			}
+
+		public:
+			void refresh();
+			bool watching() const { return bool(_watch); }
+			std::vector<ENTRY> entries() const {
+				std::map<std::string, unsigned> m(_staged);
+				for (auto const& i : _worktree) {
+					m[i.first] |= i.second;
+				}
+				std::vector<ENTRY> e;
+				for (auto const& i : m) {
+					e.push_back(ENTRY(i.first, i.second));
+				}
+				return e;
+			}
+
+		private:
+			void scan(std::set<std::string>& dirty);
+			void index_changes(std::set<std::string>& dirty);
+			void check(std::set<std::string> const& paths, git_status_show_t show,
+					std::map<std::string, unsigned>& result);
+
+		private:
+			REPO& _repo;
+			std::unique_ptr<INOTIFY> _watch;
+			bool _full; // rescan everything
+			bool _index; // index changed
+			std::map<std::string, unsigned> _staged;
+			std::map<std::string, unsigned> _worktree;
+			std::map<std::string, git_index_entry> _entries; // with watch, less the paths
+	};
+
+	inline std::ostream& operator<< (std::ostream& o, STATUS::ENTRY const& e)
 	{
-		return BRANCHES(*this);
+		return e.print(o);
 	}
 
-	inline CONFIG::CONFIG(REPO& r) // : _repo(r)
+	// run git_status_list_new, restricted to paths unless empty.
+	inline void STATUS::check(std::set<std::string> const& paths, git_status_show_t show,
+			std::map<std::string, unsigned>& result)
 	{
-		if (git_repository_config(&_cfg, r._repo)) {
-			throw EXCEPTION("can't open config for repo");
+		git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+		opts.show = show;
+		opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_EXCLUDE_SUBMODULES
+			| GIT_STATUS_OPT_SORT_CASE_SENSITIVELY;
+
+		std::vector<char*> ps;
+		if (paths.size()) {
+			for (auto const& p : paths) {
+				ps.push_back(const_cast<char*>(p.c_str()));
+			}
+			opts.pathspec.strings = ps.data();
+			opts.pathspec.count = ps.size();
+			opts.flags |= GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+		} else {
+		}
+
+		git_status_list* l;
+		if (git_status_list_new(&l, _repo._repo, &opts)) { untested();
+			throw EXCEPTION("status error: " + std::string(giterr_last()->message));
 		} else {
 		}
+
+		for (size_t i = 0; i < git_status_list_entrycount(l); ++i) {
+			git_status_entry const* e = git_status_byindex(l, i);
+			git_diff_delta const* d = e->index_to_workdir ? e->index_to_workdir : e->head_to_index;
+			if (e->status == GIT_STATUS_CURRENT || !d) { untested();
+			} else {
+				result[d->new_file.path ? d->new_file.path : d->old_file.path] = e->status;
+			}
+		}
+
+		git_status_list_free(l);
 	}
-	// ---------------------------------------------------------------------------- //
-	inline COMMITS::COMMITS(REPO& r)
-		: _repo(r)
+
+	static bool stat_differs(git_index_entry const* e, struct stat const& st, int64_t racy)
 	{
-		git_revwalk_new(&_walk, _repo._repo);
+		if (int64_t(st.st_mtim.tv_sec) >= racy) {
+			// modified in the same second the index was written, can't tell.
+			return true;
+		} else if (e->mtime.seconds != st.st_mtim.tv_sec) {
+			return true;
+		} else if (e->mtime.nanoseconds && e->mtime.nanoseconds != uint32_t(st.st_mtim.tv_nsec)) {
+			return true;
+		} else if (e->file_size != uint32_t(st.st_size)) {
+			return true;
+		} else if (e->ino && e->ino != uint32_t(st.st_ino)) { untested();
+			return true;
+		} else {
+			return (e->mode & S_IFMT) != (st.st_mode & S_IFMT);
+		}
+	}
 
-		int error;
-		git_object *obj;
+	static bool entry_differs(git_index_entry const& a, git_index_entry const& b)
+	{
+		return !git_oid_equal(&a.id, &b.id)
+			|| a.mtime.seconds != b.mtime.seconds
+			|| a.mtime.nanoseconds != b.mtime.nanoseconds
+			|| a.file_size != b.file_size
+			|| a.ino != b.ino
+			|| a.mode != b.mode
+			|| a.flags != b.flags;
+	}
 
-		if ((error = git_revparse_single(&obj, _repo._repo, "HEAD")) < 0) {
-			// cannot resolve HEAD.
-			_walk = nullptr;
+	// the paths whose index entries were added, removed or changed since
+	// the last call. a path in a directory the index had nothing in before
+	// is not watched yet, that takes a full scan.
+	inline void STATUS::index_changes(std::set<std::string>& dirty)
+	{
+		git_index* idx;
+		if (git_repository_index(&idx, _repo._repo)) { untested();
+			throw EXCEPTION("can't open index");
 		} else {
-			error = git_revwalk_push(_walk, git_object_id(obj));
-			git_object_free(obj);
+		}
 
-			if (error) { untested();
-				throw error;
+		std::map<std::string, git_index_entry> now;
+		for (size_t i = 0; i < git_index_entrycount(idx); ++i) {
+			git_index_entry e = *git_index_get_byindex(idx, i);
+			std::string p(e.path);
+			e.path = NULL;
+			now[p] = e;
+		}
+		git_index_free(idx);
+
+		// a directory the old entries have something in
+		auto known = [&](std::string const& p) {
+			size_t s = p.rfind('/');
+			if (s == std::string::npos) {
+				return true;
 			} else {
+				std::string d = p.substr(0, s + 1);
+				auto i = _entries.lower_bound(d);
+				return i != _entries.end() && !i->first.compare(0, d.size(), d);
+			}
+		};
+
+		auto a = _entries.begin();
+		auto b = now.begin();
+		while (a != _entries.end() || b != now.end()) {
+			if (b == now.end() || (a != _entries.end() && a->first < b->first)) {
+				dirty.insert(a->first);
+				++a;
+			} else if (a == _entries.end() || b->first < a->first) {
+				dirty.insert(b->first);
+				_full |= !known(b->first);
+				++b;
+			} else {
+				if (entry_differs(a->second, b->second)) {
+					dirty.insert(a->first);
+				} else {
+				}
+				++a;
+				++b;
 			}
 		}
-	}
 
-	inline COMMIT COMMITS::COMMIT_WALKER::operator*()
-	{
-		return COMMIT(_id, _c->_repo._repo);
+		_entries.swap(now);
 	}
 
-	inline CONFIG::ITEM CONFIG::ITER::operator*()
+	// compare the working tree with the index stat data, collect paths that
+	// may have changed and paths the index doesn't know about.
+	inline void STATUS::scan(std::set<std::string>& dirty)
 	{
-		return CONFIG::ITEM(_e, _i, _cfg);
+		git_index* idx;
+		if (git_repository_index(&idx, _repo._repo)) { untested();
+			throw EXCEPTION("can't open index");
+		} else {
+		}
+
+		struct stat st;
+		std::string wd = _repo.workdir();
+		int64_t racy = stat(git_index_path(idx), &st) ? 0 : int64_t(st.st_mtim.tv_sec);
+
+		// tracked files by directory
+		typedef std::vector<std::pair<std::string, git_index_entry const*> > files_t;
+		std::map<std::string, files_t> dirs;
+		dirs[""];
+		for (size_t i = 0; i < git_index_entrycount(idx); ++i) {
+			git_index_entry const* e = git_index_get_byindex(idx, i);
+			std::string p(e->path);
+			size_t s = p.rfind('/');
+			std::string d = s == std::string::npos ? "" : p.substr(0, s + 1);
+			dirs[d].push_back(std::make_pair(p.substr(d.size()), e));
+
+			// make sure parents are scanned
+			while (s != std::string::npos && s) {
+				s = p.rfind('/', s - 1);
+				dirs[s == std::string::npos ? "" : p.substr(0, s + 1)];
+			}
+		}
+
+		std::vector<std::string> names;
+		for (auto& d : dirs) {
+			names.push_back(d.first);
+			std::sort(d.second.begin(), d.second.end(), [](files_t::value_type const& a,
+						files_t::value_type const& b) {
+				return a.first < b.first;
+			});
+		}
+
+		POOL pool;
+		std::vector<std::vector<std::string> > found(pool.size());
+		pool.run(names.size(), [&](size_t i, unsigned w) {
+			std::string const& d = names[i];
+			files_t const& f = dirs.find(d)->second;
+			std::vector<bool> seen(f.size(), false);
+			std::vector<std::string>& out = found[w];
+
+			if (_watch && !_watch->watch(wd + d, d)) { untested();
+				// too many directories. do without.
+			} else {
+			}
+
+			DIR* dir = opendir((wd + d).c_str());
+			if (!dir) {
+				for (auto const& x : f) {
+					out.push_back(d + x.first);
+				}
+				return;
+			} else {
+			}
+
+			struct stat st;
+			while (struct dirent* e = readdir(dir)) {
+				std::string n(e->d_name);
+				std::string p = d + n;
+				auto x = std::lower_bound(f.begin(), f.end(), n, [](files_t::value_type const& a,
+							std::string const& b) {
+					return a.first < b;
+				});
+
+				if (n == "." || n == ".." || p == ".git") {
+				} else if (x != f.end() && x->first == n) {
+					seen[x - f.begin()] = true;
+					if (lstat((wd + p).c_str(), &st) || stat_differs(x->second, st, racy)) {
+						out.push_back(p);
+					} else {
+					}
+				} else if (dirs.count(p + "/")) {
+					// tracked directory, scanned by itself.
+				} else if (e->d_type == DT_DIR) {
+					out.push_back(p + "/");
+				} else {
+					out.push_back(p);
+				}
+			}
+			closedir(dir);
+
+			// deleted
+			for (size_t k = 0; k < f.size(); ++k) {
+				if (!seen[k]) {
+					out.push_back(d + f[k].first);
+				} else {
+				}
+			}
+		});
+
+		for (auto const& v : found) {
+			dirty.insert(v.begin(), v.end());
+		}
+
+		git_index_free(idx);
 	}
 
-	static int resolve_refish(git_annotated_commit **commit, git_repository *repo, const char *refish)
+	inline void STATUS::refresh()
 	{
-		git_reference *ref;
-		git_object *obj;
-		int err = 0;
+		std::set<std::string> dirty;
+		std::string const dotgit = ".git/";
 
-		assert(commit != NULL);
+		if (!_watch) {
+			_full = _index = true;
+		} else if (!_watch->poll([&](std::string const& p, uint32_t m) {
+					if (p.compare(0, dotgit.size(), dotgit)) {
+						dirty.insert(p);
+					} else if (p == dotgit + "index") {
+						_index = true;
+					} else {
+					}
+					if (m & (IN_DELETE_SELF | IN_MOVE_SELF)) { untested();
+						_full = true;
+					} else if ((m & (IN_CREATE | IN_MOVED_TO)) && (m & IN_ISDIR)) {
+						// new directory, may become tracked
+						_full = true;
+					} else {
+					}
+				})) { untested();
+			_full = true;
+		} else {
+		}
 
-		err = git_reference_dwim(&ref, repo, refish);
-		assert(ref);
+		if (_index) {
+			_staged.clear();
+			check(std::set<std::string>(), GIT_STATUS_SHOW_INDEX_ONLY, _staged);
+			if (_watch) {
+				// index stat data may have changed too.
+				index_changes(dirty);
+			} else {
+			}
+		} else {
+		}
 
-		if (err == GIT_OK) {
-			git_annotated_commit_from_ref(commit, repo, ref);
-			//	git_reference_free(ref); memory leak
-			return 0;
+		if (_full) {
+			if (_watch) {
+				_watch.reset(new INOTIFY);
+				_watch->watch(_repo.path(), dotgit, IN_CLOSE_WRITE | IN_MOVED_TO);
+			} else {
+			}
+			dirty.clear();
+			scan(dirty);
+			_worktree.clear();
 		} else {
+			// recheck what was dirty before, it may be clean now.
+			for (auto const& i : _worktree) {
+				dirty.insert(i.first);
+			}
+			for (auto const& p : dirty) {
+				_worktree.erase(p);
+			}
 		}
 
-		err = git_revparse_single(&obj, repo, refish);
-		if (err == GIT_OK) {
-			err = git_annotated_commit_lookup(commit, repo, git_object_id(obj));
-			//	git_object_free(obj); memory leak
+		if (dirty.size()) {
+			check(dirty, GIT_STATUS_SHOW_WORKDIR_ONLY, _worktree);
 		} else {
 		}
 
-		return err;
+		_full = _index = false;
+	}
+
+	// change notification for HEAD, refs, packed-refs, config and index.
+	// poll() publishes what changed to the subscribers, so that cached views
+	// are only rebuilt when their inputs did change.
+	class NOTIFY {
+		public:
+			enum {
+				_head = 1,
+				_refs = 2,
+				_config = 4,
+				_index = 8,
+				_all = 15
+			};
+			typedef std::function<void(unsigned)> callback_t;
+
+		public:
+			explicit NOTIFY(REPO const& r) : _git(r.path()) {
+				_in.watch(_git, "", _mask);
+				watch_refs("refs/");
+			}
+
+		public:
+			// f(what) is called for every change that intersects mask.
+			void subscribe(unsigned mask, callback_t f) {
+				_sub.push_back(std::make_pair(mask, f));
+			}
+
+			// dispatch pending changes, don't block. returns what changed.
+			unsigned poll() {
+				unsigned what = 0;
+				std::vector<std::string> dirs;
+
+				if (!_in.poll([&](std::string const& p, uint32_t m) {
+							what |= kind(p);
+							if ((m & IN_ISDIR) && (m & (IN_CREATE | IN_MOVED_TO)) && (kind(p) & _refs)) {
+								dirs.push_back(p + "/");
+							} else {
+							}
+						})) { untested();
+					what = _all;
+				} else {
+				}
+
+				for (auto const& d : dirs) {
+					watch_refs(d);
+				}
+				for (auto const& s : _sub) {
+					if (s.first & what) {
+						s.second(s.first & what);
+					} else {
+					}
+				}
+
+				return what;
+			}
+
+			// becomes readable when poll() has something to do
+			int fd() const { return _in.fd(); }
+
+		private:
+			enum {
+				_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE
+			};
+
+			static unsigned kind(std::string const& p) {
+				std::string const lock = ".lock";
+				if (p.size() >= lock.size() && !p.compare(p.size() - lock.size(), lock.size(), lock)) {
+					// not committed yet
+					return 0;
+				} else if (p == "HEAD") {
+					return _head;
+				} else if (p == "packed-refs" || !p.compare(0, 5, "refs/")) {
+					return _refs;
+				} else if (p == "config") {
+					return _config;
+				} else if (p == "index") {
+					return _index;
+				} else {
+					return 0;
+				}
+			}
+
+			void watch_refs(std::string const& d) {
+				_in.watch(_git + d, d, _mask);
+				if (DIR* dir = opendir((_git + d).c_str())) {
+					while (struct dirent* e = readdir(dir)) {
+						if (e->d_name[0] == '.' || e->d_type != DT_DIR) {
+						} else {
+							watch_refs(d + e->d_name + "/");
+						}
+					}
+					closedir(dir);
+				} else { untested();
+				}
+			}
+
+		private:
+			std::string _git;
+			INOTIFY _in;
+			std::vector<std::pair<unsigned, callback_t> > _sub;
+	};
+
+	// stream the log, one record per commit, as NDJSON
+	//   {"id":"..","parents":[".."],"author":"..","email":"..","time":0,"offset":0,"message":".."}
+	// with ids abbreviated if an OID_INDEX is given,
+	// or binary, little endian
+	//   u32 record size (excluding itself), 20 bytes id, u8 parents,
+	//   20 bytes per parent, i64 time, i16 offset (minutes),
+	//   then author, email, message, each a u32 size and the bytes.
+	class EXPORT {
+		public:
+			enum format_t {
+				_ndjson,
+				_binary
+			};
+		public:
+			EXPORT(WRITER& w, format_t f, OID_INDEX const* abbrev = NULL)
+				: _w(w), _f(f), _abbrev(abbrev) {}
+
+		public:
+			// number of commits written
+			size_t operator()(COMMITS& c) {
+				size_t n = 0;
+				git_oid id;
+				git_repository* r = c._repo._repo;
+
+				while (c.next(id)) {
+					git_commit* x = c._cur;
+					c._cur = NULL;
+					if (!x && git_commit_lookup(&x, r, &id)) { untested();
+						throw EXCEPTION("lookup error");
+					} else if (_f == _ndjson) {
+						ndjson(id, x);
+					} else {
+						binary(id, x);
+					}
+					git_commit_free(x);
+					++n;
+				}
+
+				_w.flush();
+				return n;
+			}
+
+		private:
+			void ndjson(git_oid const& id, git_commit* c) {
+				git_signature const* a = git_commit_author(c);
+				char const* m = git_commit_message(c);
+
+				_w.put("{\"id\":\"");
+				hex(id);
+				_w.put("\",\"parents\":[");
+				for (unsigned i = 0; i < git_commit_parentcount(c); ++i) {
+					_w.put(i ? ",\"" : "\"");
+					hex(*git_commit_parent_id(c, i));
+					_w.put('"');
+				}
+				_w.put("],\"author\":");
+				_w.put_json(a->name, strlen(a->name));
+				_w.put(",\"email\":");
+				_w.put_json(a->email, strlen(a->email));
+				_w.put(",\"time\":");
+				_w.put_int(git_commit_time(c));
+				_w.put(",\"offset\":");
+				_w.put_int(git_commit_time_offset(c));
+				_w.put(",\"message\":");
+				_w.put_json(m, strlen(m));
+				_w.put("}\n");
+			}
+
+			void hex(git_oid const& id) {
+				_w.put_hex(id, _abbrev ? _abbrev->abbrev(id) : unsigned(GIT_OID_HEXSZ));
+			}
+
+			void binary(git_oid const& id, git_commit* c) {
+				git_signature const* a = git_commit_author(c);
+				char const* m = git_commit_message(c);
+				size_t an = strlen(a->name);
+				size_t en = strlen(a->email);
+				size_t mn = strlen(m);
+				unsigned p = git_commit_parentcount(c);
+
+				_w.put_le(GIT_OID_RAWSZ * (1 + p) + 1 + 8 + 2 + 12 + an + en + mn, 4);
+				_w.put_raw(id);
+				_w.put_le(p, 1);
+				for (unsigned i = 0; i < p; ++i) {
+					_w.put_raw(*git_commit_parent_id(c, i));
+				}
+				_w.put_le(git_commit_time(c), 8);
+				_w.put_le(git_commit_time_offset(c), 2);
+				_w.put_le(an, 4);
+				_w.put(a->name, an);
+				_w.put_le(en, 4);
+				_w.put(a->email, en);
+				_w.put_le(mn, 4);
+				_w.put(m, mn);
+			}
+
+		private:
+			WRITER& _w;
+			format_t _f;
+			OID_INDEX const* _abbrev;
+	};
+
+	// libgit2 tuning, global to the process. settings are read from hci.* keys
+	// in the repository config and can be overridden with set(), as in
+	// "git -c". apply() keeps the library initialised from then on, so the
+	// settings survive REPOs coming and going.
+	//
+	//   hci.cacheMaxSize            object cache, bytes in total
+	//   hci.cacheLimit{Commit,Tree,Blob,Tag}
+	//                               largest object of that type to cache
+	//   hci.caching                 object cache on/off
+	//   hci.mwindowMappedLimit      pack data mapped at most, bytes
+	//   hci.mwindowFileLimit        pack files open at most
+	//   hci.strictObjectCreation    check objects refer to existing ones
+	//   hci.strictHashVerification  check object hashes on read
+	//   hci.prefetch                read ahead this much of each pack
+	//                               before long walks (see PREFETCH)
+	//   hci.autoPack                pack loose objects at start when there
+	//                               are more than this (see REPACK)
+	//
+	// sizes take k, m and g suffixes, switches true/false.
+	class PROFILE {
+		public:
+			// true if key is one of the above
+			bool set(std::string const& key, std::string const& value) {
+				std::string k(key);
+				std::transform(k.begin(), k.end(), k.begin(), ::tolower);
+				for (KEY const* i = keys(); i->name; ++i) {
+					if (k == i->name) {
+						_v[i->name] = parse(value);
+						return true;
+					} else {
+					}
+				}
+				return false;
+			}
+
+			void load(CONFIG& c) {
+				for (auto i : c) {
+					std::string n = i.name();
+					if (!n.compare(0, 4, "hci.") && !_v.count(n)) {
+						set(n, i.value());
+					} else {
+					}
+				}
+			}
+
+			void apply() const {
+				static bool pinned = false;
+				if (!pinned) {
+					git_libgit2_init();
+					pinned = true;
+				} else {
+				}
+
+				for (auto const& v : _v) {
+					std::string const& k = v.first;
+					if (k == "hci.cachemaxsize") {
+						git_libgit2_opts(GIT_OPT_SET_CACHE_MAX_SIZE, ssize_t(v.second));
+					} else if (k == "hci.cachelimitcommit") {
+						git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_COMMIT, size_t(v.second));
+					} else if (k == "hci.cachelimittree") {
+						git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_TREE, size_t(v.second));
+					} else if (k == "hci.cachelimitblob") {
+						git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_BLOB, size_t(v.second));
+					} else if (k == "hci.cachelimittag") {
+						git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_TAG, size_t(v.second));
+					} else if (k == "hci.caching") {
+						git_libgit2_opts(GIT_OPT_ENABLE_CACHING, int(v.second));
+					} else if (k == "hci.mwindowmappedlimit") {
+						git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, size_t(v.second));
+					} else if (k == "hci.mwindowfilelimit") {
+						git_libgit2_opts(GIT_OPT_SET_MWINDOW_FILE_LIMIT, size_t(v.second));
+					} else if (k == "hci.strictobjectcreation") {
+						git_libgit2_opts(GIT_OPT_ENABLE_STRICT_OBJECT_CREATION, int(v.second));
+					} else if (k == "hci.stricthashverification") {
+						git_libgit2_opts(GIT_OPT_ENABLE_STRICT_HASH_VERIFICATION, int(v.second));
+					} else if (k == "hci.prefetch" || k == "hci.autopack") {
+						// not a library setting, see get()
+					} else { untested();
+						unreachable();
+					}
+				}
+			}
+
+			int64_t get(std::string const& key, int64_t dflt) const {
+				auto i = _v.find(key);
+				return i == _v.end() ? dflt : i->second;
+			}
+
+			// settings in effect
+			std::ostream& print(std::ostream& o) const {
+				for (auto const& v : _v) {
+					o << v.first << " = " << v.second << "\n";
+				}
+				return o;
+			}
+
+		public: // diagnostics
+			// a GITPP cache was asked for name
+			static void count(char const* name, bool hit) {
+				std::lock_guard<std::mutex> l(lock());
+				auto& c = counters()[name];
+				++(hit ? c.first : c.second);
+			}
+
+			// library state, cache counters and pack memory mapped
+			static std::ostream& report(std::ostream& o) {
+				ssize_t cur = 0;
+				ssize_t max = 0;
+				size_t mapped_limit = 0;
+				size_t file_limit = 0;
+				size_t window = 0;
+				git_libgit2_opts(GIT_OPT_GET_CACHED_MEMORY, &cur, &max);
+				git_libgit2_opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, &mapped_limit);
+				git_libgit2_opts(GIT_OPT_GET_MWINDOW_FILE_LIMIT, &file_limit);
+				git_libgit2_opts(GIT_OPT_GET_MWINDOW_SIZE, &window);
+
+				o << "object cache:      " << cur / 1024 << " of " << max / 1024 << " KiB\n";
+				o << "mwindow size:      " << window / 1024 << " KiB\n";
+				o << "mapped limit:      " << mapped_limit / 1024 << " KiB\n";
+				o << "file limit:        " << file_limit << (file_limit ? "\n" : " (none)\n");
+
+				// libgit2 doesn't tell how much it mapped. the kernel does.
+				uint64_t mapped = 0;
+				std::set<std::string> packs;
+				std::ifstream maps("/proc/self/maps");
+				for (std::string line; std::getline(maps, line); ) {
+					size_t p = line.find('/');
+					unsigned long b;
+					unsigned long e;
+					if (p == std::string::npos || line.size() < 5
+							|| line.compare(line.size() - 5, 5, ".pack")) {
+					} else if (sscanf(line.c_str(), "%lx-%lx", &b, &e) == 2) {
+						mapped += e - b;
+						packs.insert(line.substr(p));
+					} else { untested();
+					}
+				}
+				o << "pack data mapped:  " << mapped / 1024 << " KiB in "
+					<< packs.size() << " packs\n\n";
+
+				std::lock_guard<std::mutex> l(lock());
+				for (auto const& c : counters()) {
+					o << c.first << ": " << c.second.first << " hits, "
+						<< c.second.second << " misses\n";
+				}
+				return o;
+			}
+
+		private:
+			struct KEY {
+				char const* name;
+			};
+			static KEY const* keys() {
+				static KEY const k[] = {
+					{"hci.cachemaxsize"},
+					{"hci.cachelimitcommit"},
+					{"hci.cachelimittree"},
+					{"hci.cachelimitblob"},
+					{"hci.cachelimittag"},
+					{"hci.caching"},
+					{"hci.mwindowmappedlimit"},
+					{"hci.mwindowfilelimit"},
+					{"hci.strictobjectcreation"},
+					{"hci.stricthashverification"},
+					{"hci.prefetch"},
+					{"hci.autopack"},
+					{NULL}
+				};
+				return k;
+			}
+			static int64_t parse(std::string const& v) {
+				if (v == "true" || v == "yes" || v == "on") {
+					return 1;
+				} else if (v == "false" || v == "no" || v == "off") {
+					return 0;
+				} else {
+				}
+
+				char* e;
+				int64_t n = strtoll(v.c_str(), &e, 10);
+				switch (tolower(*e)) {
+					case 'g': n <<= 10; // fall through
+					case 'm': n <<= 10; // fall through
+					case 'k': n <<= 10; break;
+					default: break;
+				}
+				return n;
+			}
+			static std::mutex& lock() {
+				static std::mutex m;
+				return m;
+			}
+			static std::map<std::string, std::pair<size_t, size_t> >& counters() {
+				static std::map<std::string, std::pair<size_t, size_t> > c;
+				return c;
+			}
+
+		private:
+			std::map<std::string, int64_t> _v;
+	};
+
+	// warm the page cache for the packs a walk is about to read, while the
+	// walk gets going. the kernel is asked to read ahead (posix_fadvise), and
+	// a thread reads sequentially behind it, so that the walk's random reads
+	// find the data in memory. libgit2 maps the packs itself, so madvise on
+	// its mappings is not an option.
+	//
+	// indexes are read in full, they are small and read at random. git
+	// writes commits at the start of a pack, so a history walk mostly reads
+	// the first part. limit is how much of each pack, 0 for all of it.
+	class PREFETCH {
+		public:
+			PREFETCH(REPO const& r, uint64_t limit) : _stop(false) {
+				std::string d = r.path() + "objects/pack/";
+				std::vector<std::pair<std::string, uint64_t> > files;
+
+				if (DIR* dir = opendir(d.c_str())) {
+					while (struct dirent* e = readdir(dir)) {
+						std::string n(e->d_name);
+						if (n.size() < 5) {
+						} else if (!n.compare(n.size() - 4, 4, ".idx")) {
+							files.insert(files.begin(), std::make_pair(d + n, uint64_t(0)));
+						} else if (!n.compare(n.size() - 5, 5, ".pack")) {
+							files.push_back(std::make_pair(d + n, limit));
+						} else {
+						}
+					}
+					closedir(dir);
+				} else { untested();
+				}
+
+				for (auto const& f : files) {
+					int fd = open(f.first.c_str(), O_RDONLY | O_CLOEXEC);
+					if (fd < 0) { untested();
+						continue;
+					} else {
+					}
+					posix_fadvise(fd, 0, f.second, POSIX_FADV_WILLNEED);
+					_fd.push_back(std::make_pair(fd, f.second));
+				}
+
+				_t = std::thread([this] {
+					std::vector<char> buf(1 << 20);
+					for (auto const& f : _fd) {
+						off_t end = f.second ? off_t(f.second) : std::numeric_limits<off_t>::max();
+						for (off_t o = 0; o < end && !_stop; ) {
+							ssize_t n = pread(f.first, buf.data(), buf.size(), o);
+							if (n <= 0) {
+								break;
+							} else {
+								o += n;
+							}
+						}
+					}
+				});
+			}
+			~PREFETCH() {
+				_stop = true;
+				_t.join();
+				for (auto const& f : _fd) {
+					close(f.first);
+				}
+			}
+		private:
+			PREFETCH(PREFETCH const&);
+
+		private:
+			std::vector<std::pair<int, uint64_t> > _fd;
+			std::atomic<bool> _stop;
+			std::thread _t;
+	};
+
+	// a tag. name without "refs/tags/".
+	class TAG {
+		public:
+			TAG(std::string const& n, OID const& t, OID const& p)
+				: _name(n), _target(t), _peeled(p) {}
+		public:
+			std::string const& name() const { return _name; }
+			// what the ref points to, a tag object if annotated
+			OID const& target() const { return _target; }
+			// what it finally points to, usually a commit
+			OID const& peeled() const { return _peeled; }
+			bool annotated() const { return _target != _peeled; }
+			std::ostream& print(std::ostream& o) const {
+				return o << _name;
+			}
+		private:
+			std::string _name;
+			OID _target;
+			OID _peeled;
+	};
+
+	inline std::ostream& operator<< (std::ostream& o, TAG const& t)
+	{
+		return t.print(o);
+	}
+
+	// the tags of a repository, sorted by name.
+	//
+	// listing reads packed-refs and refs/tags, and no objects: peeled
+	// targets come from the "^" lines in packed-refs. loose tags are peeled
+	// once per session, tag objects don't change.
+	//
+	// for the same reason, tagger and date are kept between runs in the
+	// VIEW_STORE as "tag-info", by target id. only new tags are read.
+	class TAGS {
+		public:
+			// tagger and date, see info()
+			class INFO {
+				public:
+					INFO() : _seconds(0) {}
+					INFO(std::string const& t, git_time_t s) : _tagger(t), _seconds(s) {}
+				public:
+					// empty for lightweight tags
+					std::string const& tagger() const { return _tagger; }
+					git_time_t seconds() const { return _seconds; }
+				private:
+					std::string _tagger;
+					git_time_t _seconds;
+			};
+			typedef std::vector<TAG>::const_iterator iterator;
+
+		public:
+			explicit TAGS(REPO& r) : _repo(r), _new_info(false) {
+				std::map<std::string, std::pair<OID, OID> > t;
+				read_packed(t);
+				read_loose("refs/tags/", t);
+				for (auto const& i : t) {
+					_t.push_back(TAG(i.first, i.second.first, i.second.second));
+				}
+			}
+
+		public:
+			iterator begin() const { return _t.begin(); }
+			iterator end() const { return _t.end(); }
+			size_t size() const { return _t.size(); }
+
+			// saves new info()
+			~TAGS();
+
+			// tagger and date of an annotated tag, the commit date of a
+			// lightweight one. read once, see above.
+			INFO info(TAG const& t) const;
+
+			// tags matching pattern (fnmatch) that contain commit
+			std::vector<TAG> containing(OID const& commit, std::string const& pattern = "*") const;
+
+		private:
+			void read_packed(std::map<std::string, std::pair<OID, OID> >& t) {
+				std::ifstream f(_repo.path() + "packed-refs");
+				std::string line;
+				std::string last;
+				git_oid id;
+				// "peeled" covers refs/tags, "fully-peeled" all refs
+				bool peeled = false;
+				std::set<std::string> carets;
+
+				while (std::getline(f, line)) {
+					if (line.empty()) { untested();
+					} else if (line[0] == '#') {
+						peeled = line.find(" peeled") != std::string::npos
+							|| line.find(" fully-peeled") != std::string::npos;
+					} else if (line[0] == '^' && last.size()) {
+						if (!git_oid_fromstrn(&id, line.c_str() + 1, GIT_OID_HEXSZ)) {
+							t[last].second = id;
+							carets.insert(last);
+						} else { untested();
+						}
+					} else if (line.size() > GIT_OID_HEXSZ + 1
+							&& !line.compare(GIT_OID_HEXSZ + 1, 10, "refs/tags/")
+							&& !git_oid_fromstrn(&id, line.c_str(), GIT_OID_HEXSZ)) {
+						last = line.substr(GIT_OID_HEXSZ + 11);
+						t[last] = std::make_pair(OID(id), OID(id));
+					} else {
+						last = "";
+					}
+				}
+
+				// without a "^" line, it peels to itself. unless the file
+				// doesn't say so.
+				if (peeled) {
+				} else {
+					for (auto& i : t) {
+						if (!carets.count(i.first)) {
+							i.second.second = peel(i.second.first);
+						} else {
+						}
+					}
+				}
+			}
+
+			void read_loose(std::string const& d, std::map<std::string, std::pair<OID, OID> >& t) {
+				DIR* dir = opendir((_repo.path() + d).c_str());
+				if (!dir) {
+					return;
+				} else {
+				}
+
+				while (struct dirent* e = readdir(dir)) {
+					std::string n = d + e->d_name;
+					std::string line;
+					git_oid id;
+					if (e->d_name[0] == '.') {
+					} else if (e->d_type == DT_DIR) {
+						read_loose(n + "/", t);
+					} else if (!std::getline(std::ifstream(_repo.path() + n), line)) { untested();
+					} else if (git_oid_fromstrn(&id, line.c_str(), GIT_OID_HEXSZ)) { untested();
+						// symbolic?
+					} else {
+						t[n.substr(10)] = std::make_pair(OID(id), peel(id));
+					}
+				}
+				closedir(dir);
+			}
+
+			// session cache
+			OID peel(OID const& id) const {
+				static std::mutex m;
+				static std::unordered_map<OID, OID> cache;
+				std::lock_guard<std::mutex> l(m);
+
+				auto c = cache.find(id);
+				if (c != cache.end()) {
+					PROFILE::count("peel cache", true);
+					return c->second;
+				} else {
+					PROFILE::count("peel cache", false);
+				}
+
+				// most tags are lightweight, the header says so without
+				// inflating the commit.
+				git_odb* odb;
+				size_t len;
+				git_object_t type = GIT_OBJECT_TAG;
+				if (!git_repository_odb(&odb, _repo._repo)) {
+					if (git_odb_read_header(&len, &type, odb, &id.get())) { untested();
+						type = GIT_OBJECT_TAG;
+					} else {
+					}
+					git_odb_free(odb);
+				} else { untested();
+				}
+
+				git_object* o;
+				git_object* p;
+				OID r = id;
+				if (type != GIT_OBJECT_TAG) {
+				} else if (git_object_lookup(&o, _repo._repo, &id.get(), GIT_OBJECT_ANY)) { untested();
+				} else if (git_object_type(o) != GIT_OBJECT_TAG) { untested();
+					git_object_free(o);
+				} else if (git_object_peel(&p, o, GIT_OBJECT_ANY)) { untested();
+					git_object_free(o);
+				} else {
+					// a tag of a tag?
+					while (git_object_type(p) == GIT_OBJECT_TAG) { untested();
+						git_object* q;
+						if (git_object_peel(&q, p, GIT_OBJECT_ANY)) {
+							break;
+						} else {
+						}
+						git_object_free(p);
+						p = q;
+					}
+					r = *git_object_id(p);
+					git_object_free(p);
+					git_object_free(o);
+				}
+
+				cache[id] = r;
+				return r;
+			}
+
+		private:
+			typedef std::unordered_map<OID, INFO> INFOS;
+			// info() by repository, shared by all TAGS
+			struct INFO_CACHE {
+				std::mutex m;
+				std::map<std::string, INFOS> repos;
+			};
+			static INFO_CACHE& info_cache() {
+				static INFO_CACHE c;
+				return c;
+			}
+			// the stored infos of this repository, loaded on first use
+			INFOS& infos() const;
+
+		private:
+			REPO& _repo;
+			std::vector<TAG> _t;
+			mutable bool _new_info; // info() added to infos()
+	};
+
+	// one walk for all tags, remembering which commits reach the target.
+	// commits older than the target (with a day of slack for clock skew)
+	// can't contain it, the walk stops there.
+	inline std::vector<TAG> TAGS::containing(OID const& commit, std::string const& pattern) const
+	{
+		std::vector<TAG> result;
+		std::unordered_map<OID, bool> memo;
+		git_commit* c;
+
+		if (git_commit_lookup(&c, _repo._repo, &commit.get())) {
+			throw EXCEPTION_CANT_FIND(commit.str());
+		} else {
+		}
+		git_time_t const cutoff = git_commit_time(c) - 86400;
+		git_commit_free(c);
+		memo[commit] = true;
+
+		for (auto const& t : _t) {
+			if (fnmatch(pattern.c_str(), t.name().c_str(), 0)) {
+				continue;
+			} else {
+			}
+
+			// depth first, a commit is decided when all its parents are.
+			std::stack<std::pair<OID, unsigned> > todo;
+			todo.push(std::make_pair(t.peeled(), 0u));
+			while (todo.size()) {
+				OID id = todo.top().first;
+				unsigned& next = todo.top().second;
+
+				if (memo.count(id)) {
+					todo.pop();
+					continue;
+				} else if (git_commit_lookup(&c, _repo._repo, &id.get())) {
+					// not a commit
+					memo[id] = false;
+					todo.pop();
+					continue;
+				} else if (git_commit_time(c) < cutoff) {
+					memo[id] = false;
+					git_commit_free(c);
+					todo.pop();
+					continue;
+				} else {
+				}
+
+				bool found = false;
+				bool pending = false;
+				for (; next < git_commit_parentcount(c); ++next) {
+					OID p = *git_commit_parent_id(c, next);
+					auto m = memo.find(p);
+					if (m == memo.end()) {
+						pending = true;
+						break;
+					} else if (m->second) {
+						found = true;
+						break;
+					} else {
+					}
+				}
+
+				if (pending) {
+					OID p = *git_commit_parent_id(c, next);
+					git_commit_free(c);
+					todo.push(std::make_pair(p, 0u));
+				} else {
+					git_commit_free(c);
+					memo[id] = found;
+					todo.pop();
+				}
+			}
+
+			if (memo[t.peeled()]) {
+				result.push_back(t);
+			} else {
+			}
+		}
+
+		return result;
+	}
+
+	inline TAGS REPO::tags()
+	{
+		return TAGS(*this);
+	}
+
+	inline OID REPO::commit_id(std::string const& rev)
+	{
+		git_object* o;
+		git_object* c;
+		if (rev.size() >= 4 && rev.size() < GIT_OID_HEXSZ
+				&& rev.find_first_not_of("0123456789abcdef") == std::string::npos) {
+			try {
+				return resolve(rev);
+			}
+			catch (EXCEPTION const&) {
+				// a ref after all?
+			}
+		} else {
+		}
+
+		if (git_revparse_single(&o, _repo, rev.c_str())) {
+			throw EXCEPTION_CANT_FIND(rev);
+		} else if (git_object_peel(&c, o, GIT_OBJECT_COMMIT)) {
+			git_object_free(o);
+			throw EXCEPTION_INVALID("commit " + rev);
+		} else {
+			OID id = *git_object_id(c);
+			git_object_free(c);
+			git_object_free(o);
+			return id;
+		}
+	}
+
+	// the reflog of a ref, newest entry first. "HEAD", a branch name or a
+	// full ref name.
+	//
+	// reflogs of long lived refs get big. the file is mapped, and an entry
+	// is only parsed when an iterator is dereferenced, walking backwards
+	// from the end of the file.
+	class REFLOG {
+		public:
+			// one line, borrowed from the mapping
+			class ENTRY {
+				public:
+					explicit ENTRY(STRING_VIEW line) : _seconds(0), _offset(0) {
+						git_oid id;
+						if (line.size() < 2 * GIT_OID_HEXSZ + 2) { untested();
+							return;
+						} else if (!git_oid_fromstrn(&id, line.data(), GIT_OID_HEXSZ)) {
+							_old = id;
+						} else { untested();
+						}
+						if (!git_oid_fromstrn(&id, line.data() + GIT_OID_HEXSZ + 1, GIT_OID_HEXSZ)) {
+							_new = id;
+						} else { untested();
+						}
+
+						char const* b = line.data() + 2 * GIT_OID_HEXSZ + 2;
+						char const* e = line.end();
+						char const* tab = static_cast<char const*>(memchr(b, '\t', e - b));
+						if (tab) {
+							_message = STRING_VIEW(tab + 1, e - tab - 1);
+							e = tab;
+						} else { untested();
+						}
+
+						// name <email> seconds +hhmm
+						char const* lt = static_cast<char const*>(memchr(b, '<', e - b));
+						char const* gt = lt ? static_cast<char const*>(memchr(lt, '>', e - lt)) : NULL;
+						if (!gt) { untested();
+							return;
+						} else {
+						}
+						_name = STRING_VIEW(b, lt > b && lt[-1] == ' ' ? lt - b - 1 : lt - b);
+						_email = STRING_VIEW(lt + 1, gt - lt - 1);
+
+						char const* p = gt + 1;
+						for (; p < e && *p == ' '; ++p);
+						for (; p < e && *p >= '0' && *p <= '9'; ++p) {
+							_seconds = _seconds * 10 + (*p - '0');
+						}
+						for (; p < e && *p == ' '; ++p);
+						if (e - p >= 5 && (*p == '+' || *p == '-')) {
+							int hh = (p[1] - '0') * 10 + (p[2] - '0');
+							int mm = (p[3] - '0') * 10 + (p[4] - '0');
+							_offset = (*p == '-' ? -1 : 1) * (hh * 60 + mm);
+						} else { untested();
+						}
+					}
+				public:
+					OID const& old_id() const { return _old; }
+					OID const& new_id() const { return _new; }
+					STRING_VIEW name() const { return _name; }
+					STRING_VIEW email() const { return _email; }
+					git_time_t seconds() const { return _seconds; }
+					// minutes east of UTC
+					int offset() const { return _offset; }
+					// "commit: ...", "checkout: moving from ..."
+					STRING_VIEW message() const { return _message; }
+				private:
+					OID _old;
+					OID _new;
+					STRING_VIEW _name;
+					STRING_VIEW _email;
+					git_time_t _seconds;
+					int _offset;
+					STRING_VIEW _message;
+			};
+
+			class iterator {
+				public:
+					iterator(char const* b, char const* e) : _begin(b), _end(e) {
+						skip();
+					}
+				public:
+					ENTRY operator*() const {
+						return ENTRY(STRING_VIEW(_line, _end - _line));
+					}
+					iterator& operator++() {
+						_end = _line;
+						skip();
+						return *this;
+					}
+					bool operator==(iterator const& x) const { return _end == x._end; }
+					bool operator!=(iterator const& x) const { return _end != x._end; }
+				private:
+					// to the start of the line ending at _end, over empty ones
+					void skip() {
+						while (_end > _begin && _end[-1] == '\n') {
+							--_end;
+						}
+						char const* nl = _end > _begin
+							? static_cast<char const*>(memrchr(_begin, '\n', _end - _begin)) : NULL;
+						_line = nl ? nl + 1 : _begin;
+					}
+				private:
+					char const* _begin;
+					char const* _end;
+					char const* _line;
+			};
+
+		public:
+			REFLOG(REPO const& r, std::string const& ref) : _p(NULL), _n(0) {
+				std::string n = ref;
+				if (n == "HEAD" || !n.compare(0, 5, "refs/")) {
+				} else {
+					n = "refs/heads/" + n;
+				}
+				int fd = open((r.path() + "logs/" + n).c_str(), O_RDONLY | O_CLOEXEC);
+				struct stat st;
+				if (fd < 0) {
+					// no reflog, no entries
+					return;
+				} else if (fstat(fd, &st) || !st.st_size) {
+					close(fd);
+					return;
+				} else {
+				}
+
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if (m == MAP_FAILED) { untested();
+					throw EXCEPTION("cannot map reflog of " + ref);
+				} else {
+					_p = static_cast<char const*>(m);
+					_n = st.st_size;
+				}
+			}
+			~REFLOG() {
+				if (_p) {
+					munmap(const_cast<char*>(_p), _n);
+				} else {
+				}
+			}
+		private:
+			REFLOG(REFLOG const&);
+			REFLOG& operator=(REFLOG const&);
+
+		public:
+			// newest first
+			iterator begin() const { return iterator(_p, _p + _n); }
+			iterator end() const { return iterator(_p, _p); }
+			bool empty() const { return begin() == end(); }
+			// bytes, not entries. counting would read the whole file.
+			size_t size() const { return _n; }
+
+		private:
+			char const* _p;
+			size_t _n;
+	};
+
+	// lines of text containing any of a set of literal strings.
+	//
+	// memmem and memchr do the scanning, glibc has vector versions of both.
+	// matches are collected per literal, then sorted, and newlines are only
+	// counted between consecutive matching lines.
+	class LITERALS {
+		public:
+			struct HIT {
+				size_t line; // from 1
+				std::string text;
+			};
+		public:
+			explicit LITERALS(std::vector<std::string> const& l) : _l(l) {
+				_l.erase(std::remove(_l.begin(), _l.end(), std::string()), _l.end());
+			}
+		public:
+			bool empty() const { return _l.empty(); }
+			// appends a HIT for each matching line, text cut to max
+			void find(char const* p, size_t n, std::vector<HIT>& out, size_t max = 200) const {
+				std::vector<size_t> at;
+				for (auto const& l : _l) {
+					char const* q = p;
+					char const* e = p + n;
+					while (char const* m = static_cast<char const*>(memmem(q, e - q, l.data(), l.size()))) {
+						at.push_back(m - p);
+						// on to the next line, one hit per line will do.
+						char const* nl = static_cast<char const*>(memchr(m, '\n', e - m));
+						if (!nl) {
+							break;
+						} else {
+							q = nl + 1;
+						}
+					}
+				}
+				if (_l.size() > 1) {
+					std::sort(at.begin(), at.end());
+				} else {
+				}
+
+				size_t line = 1;
+				char const* counted = p;
+				char const* last = NULL;
+				for (size_t a : at) {
+					char const* m = p + a;
+					if (m < last) {
+						// same line as the previous hit
+						continue;
+					} else {
+					}
+					line += std::count(counted, m, '\n');
+					counted = m;
+
+					char const* b = m;
+					while (b > p && b[-1] != '\n') {
+						--b;
+					}
+					char const* nl = static_cast<char const*>(memchr(m, '\n', p + n - m));
+					last = nl ? nl : p + n;
+
+					HIT h;
+					h.line = line;
+					h.text.assign(b, std::min(size_t(last - b), max));
+					out.push_back(h);
+				}
+			}
+		private:
+			std::vector<std::string> _l;
+	};
+
+	// search the files of a commit, without a checkout.
+	//
+	// the tree is listed first. each distinct blob is searched once, by a
+	// pool of workers with a repository handle each, in the order its first
+	// path comes. results are read in path order with hits(), which waits
+	// for that file, so the first ones can be shown while the rest are
+	// still being searched.
+	class GREP {
+		public:
+			typedef LITERALS::HIT HIT;
+		private:
+			struct BLOB {
+				BLOB(OID const& i) : id(i), binary(false) {}
+				OID id;
+				bool binary;
+				std::vector<HIT> hits;
+			};
+		public:
+			GREP(REPO& r, OID const& commit, std::vector<std::string> const& literals, unsigned threads = 0)
+				: _lit(literals), _stop(false), _pool(threads) {
+				git_commit* c;
+				git_tree* t;
+				if (git_commit_lookup(&c, r._repo, &commit.get())) {
+					throw EXCEPTION_CANT_FIND(commit.str());
+				} else if (git_commit_tree(&t, c)) { untested();
+					git_commit_free(c);
+					throw EXCEPTION_CANT_FIND("tree of " + commit.str());
+				} else {
+					git_commit_free(c);
+				}
+
+				std::unordered_map<OID, size_t> seen;
+				auto walk = [&](char const* root, git_tree_entry const* e) {
+					if (git_tree_entry_type(e) != GIT_OBJECT_BLOB) {
+					} else if (git_tree_entry_filemode(e) == GIT_FILEMODE_LINK) {
+						// a symlink, its target isn't content
+					} else {
+						OID id = *git_tree_entry_id(e);
+						auto i = seen.insert(std::make_pair(id, _blobs.size()));
+						if (i.second) {
+							_blobs.push_back(BLOB(id));
+						} else {
+						}
+						_paths.push_back(std::make_pair(std::string(root) + git_tree_entry_name(e), i.first->second));
+					}
+				};
+				typedef decltype(walk) W;
+				git_tree_walk(t, GIT_TREEWALK_PRE, [](char const* root, git_tree_entry const* e, void* w) {
+					(*static_cast<W*>(w))(root, e);
+					return 0;
+				}, &walk);
+				git_tree_free(t);
+
+				_done.assign(_blobs.size(), false);
+				_thread = std::thread(&GREP::search, this, r.path());
+			}
+			~GREP() {
+				_stop = true;
+				_thread.join();
+			}
+		private:
+			GREP(GREP const&);
+			GREP& operator=(GREP const&);
+
+		public:
+			// files in the tree, binary or not
+			size_t size() const { return _paths.size(); }
+			std::string const& path(size_t i) const { return _paths[i].first; }
+			// waits for file i
+			std::vector<HIT> const& hits(size_t i) {
+				BLOB const& b = wait(i);
+				return b.hits;
+			}
+			bool binary(size_t i) {
+				return wait(i).binary;
+			}
+
+		private:
+			BLOB const& wait(size_t i) {
+				size_t k = _paths[i].second;
+				std::unique_lock<std::mutex> l(_m);
+				_cv.wait(l, [this, k] { return _done[k] || _error.size(); });
+				if (!_done[k]) { untested();
+					throw EXCEPTION(_error);
+				} else {
+				}
+				return _blobs[k];
+			}
+
+			void search(std::string path) {
+				POOL_REPOS repos(_pool, path);
+				try {
+					_pool.run(_blobs.size(), [&](size_t i, unsigned w) {
+						if (_stop) {
+							return;
+						} else {
+						}
+
+						BLOB& b = _blobs[i];
+						git_odb_object* o;
+						if (git_odb_read(&o, repos.odb(w), &b.id.get())) { untested();
+						} else {
+							char const* p = static_cast<char const*>(git_odb_object_data(o));
+							size_t n = git_odb_object_size(o);
+							// like git, a NUL near the start makes it binary
+							b.binary = memchr(p, 0, std::min(n, size_t(8000))) != NULL;
+							if (!b.binary) {
+								_lit.find(p, n, b.hits);
+							} else {
+							}
+							git_odb_object_free(o);
+						}
+
+						std::lock_guard<std::mutex> l(_m);
+						_done[i] = true;
+						_cv.notify_all();
+					});
+				}
+				catch (EXCEPTION const& e) { untested();
+					std::lock_guard<std::mutex> l(_m);
+					_error = e.what();
+					_cv.notify_all();
+				}
+			}
+
+		private:
+			LITERALS _lit;
+			std::vector<std::pair<std::string, size_t> > _paths; // blob index
+			std::vector<BLOB> _blobs;
+			std::vector<bool> _done;
+			std::string _error;
+			std::mutex _m;
+			std::condition_variable _cv;
+			std::atomic<bool> _stop;
+			POOL _pool;
+			std::thread _thread;
+	};
+
+	// the lines of a file at a commit, for paging through files larger than
+	// memory.
+	//
+	// the blob is read through an odb stream in chunks. the line number at
+	// the start of each chunk is recorded as it goes past, that is the
+	// whole line index. only the last few chunks are kept, going back
+	// further restarts the stream and skips forward. libgit2 only streams
+	// loose objects. a blob stored whole in a pack is inflated from the pack
+	// file here, in the same chunks. a delta needs its base, it is read in
+	// one piece, up to _max_whole bytes.
+	class BLOB_READER {
+		private:
+			struct CHUNK {
+				size_t k;
+				std::vector<char> data;
+			};
+			enum { _max_whole = 64 << 20 };
+		public:
+			BLOB_READER(REPO& r, OID const& commit, std::string const& path,
+					size_t chunk = 256 << 10, size_t keep = 16)
+				: _odb(NULL), _stream(NULL), _whole(NULL), _size(0),
+				  _objects(r.path() + "objects/"), _pack(-1), _data(0), _pos(0),
+				  _chunk(chunk), _keep(keep), _next(0) {
+				git_commit* c;
+				git_tree* t;
+				git_tree_entry* e;
+				if (git_commit_lookup(&c, r._repo, &commit.get())) {
+					throw EXCEPTION_CANT_FIND(commit.str());
+				} else if (git_commit_tree(&t, c)) { untested();
+					git_commit_free(c);
+					throw EXCEPTION_CANT_FIND("tree of " + commit.str());
+				} else if (git_tree_entry_bypath(&e, t, path.c_str())) {
+					git_tree_free(t);
+					git_commit_free(c);
+					throw EXCEPTION_CANT_FIND(path);
+				} else {
+					_id = *git_tree_entry_id(e);
+					bool blob = git_tree_entry_type(e) == GIT_OBJECT_BLOB;
+					git_tree_entry_free(e);
+					git_tree_free(t);
+					git_commit_free(c);
+					if (!blob) {
+						throw EXCEPTION_INVALID(path + " is not a file");
+					} else {
+					}
+				}
+
+				if (git_repository_odb(&_odb, r._repo)) { untested();
+					throw EXCEPTION("can't open object database");
+				} else {
+				}
+				rewind();
+				_first.push_back(1);
+			}
+			~BLOB_READER() {
+				if (_pack >= 0) {
+					inflateEnd(&_z);
+					close(_pack);
+				} else {
+				}
+				git_odb_stream_free(_stream);
+				git_odb_object_free(_whole);
+				git_odb_free(_odb);
+			}
+		private:
+			BLOB_READER(BLOB_READER const&);
+			BLOB_READER& operator=(BLOB_READER const&);
+
+		public:
+			// bytes
+			uint64_t size() const { return _size; }
+			// lines [first, first + n) into out, from 1, each cut to max.
+			// false if there are none after them.
+			bool lines(uint64_t first, size_t n, std::vector<std::string>& out, size_t max = 400) {
+				// the chunk holding the newline before line first
+				while (_first.back() < first && read_more()) {
+				}
+				size_t k = std::lower_bound(_first.begin(), _first.end(), first) - _first.begin();
+				k = k ? k - 1 : 0;
+
+				uint64_t line = _first[k];
+				bool more = false;
+				std::string cur;
+				for (CHUNK const* c; !more && (c = chunk(k)); ++k) {
+					char const* p = c->data.data();
+					char const* e = p + c->data.size();
+					while (p < e) {
+						if (line >= first && out.size() == n) {
+							more = true;
+							break;
+						} else {
+						}
+						char const* nl = static_cast<char const*>(memchr(p, '\n', e - p));
+						char const* le = nl ? nl : e;
+						if (line >= first && cur.size() < max) {
+							cur.append(p, std::min(size_t(le - p), max - cur.size()));
+						} else {
+						}
+						if (!nl) {
+							// continues in the next chunk
+							break;
+						} else if (line >= first) {
+							out.push_back(cur);
+						} else {
+						}
+						cur.clear();
+						++line;
+						p = nl + 1;
+					}
+				}
+				if (!more && cur.size()) {
+					// no newline at the end
+					out.push_back(cur);
+				} else {
+				}
+				return more;
+			}
+
+		private:
+			// the stream at the start again
+			void rewind() {
+				git_odb_stream_free(_stream);
+				_stream = NULL;
+				_next = 0;
+				git_object_t type;
+				size_t len;
+				if (_whole) {
+				} else if (_pack >= 0) {
+					inflateReset(&_z);
+					_z.avail_in = 0;
+					_pos = _data;
+				} else if (!git_odb_open_rstream(&_stream, &len, &type, _odb, &_id.get())) {
+					_size = len;
+				} else if (open_packed()) {
+				} else if (git_odb_read_header(&len, &type, _odb, &_id.get())) { untested();
+					throw EXCEPTION_CANT_FIND(_id.str());
+				} else if (len > _max_whole) {
+					throw EXCEPTION_INVALID(_id.str() + " is a delta of "
+							+ std::to_string(len) + " bytes, too large to page");
+				} else if (git_odb_read(&_whole, _odb, &_id.get())) { untested();
+					throw EXCEPTION_CANT_FIND(_id.str());
+				} else {
+					_size = git_odb_object_size(_whole);
+				}
+			}
+
+			static uint32_t be32(unsigned char const* p) {
+				return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+			}
+
+			// the offset of _id in the pack of the v2 index path
+			bool find_in_idx(std::string const& path, uint64_t& offset) const {
+				int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				struct stat st;
+				if (fd < 0) { untested();
+					return false;
+				} else if (fstat(fd, &st) || st.st_size < 8 + 256 * 4) { untested();
+					close(fd);
+					return false;
+				} else {
+				}
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if (m == MAP_FAILED) { untested();
+					return false;
+				} else {
+				}
+
+				unsigned char const* p = static_cast<unsigned char const*>(m);
+				unsigned char const* end = p + st.st_size;
+				unsigned char const* id = _id.get().id;
+				bool found = false;
+				if (memcmp(p, "\377tOc", 4) || be32(p + 4) != 2) { untested();
+					// v1, left to libgit2
+				} else {
+					unsigned char const* fan = p + 8;
+					size_t n = be32(fan + 255 * 4);
+					size_t lo = id[0] ? be32(fan + (id[0] - 1) * 4) : 0;
+					size_t hi = be32(fan + id[0] * 4);
+					unsigned char const* ids = fan + 256 * 4;
+					unsigned char const* offs = ids + n * (GIT_OID_RAWSZ + 4);
+					unsigned char const* large = offs + n * 4;
+					while (lo < hi && large <= end) {
+						size_t i = lo + (hi - lo) / 2;
+						int c = memcmp(ids + i * GIT_OID_RAWSZ, id, GIT_OID_RAWSZ);
+						if (c < 0) {
+							lo = i + 1;
+						} else if (c > 0) {
+							hi = i;
+						} else {
+							uint32_t o = be32(offs + i * 4);
+							if (!(o & 0x80000000u)) {
+								offset = o;
+								found = true;
+							} else if (large + ((o & 0x7fffffffu) + 1) * 8 <= end) {
+								unsigned char const* l = large + (o & 0x7fffffffu) * 8;
+								offset = (uint64_t(be32(l)) << 32) | be32(l + 4);
+								found = true;
+							} else { untested();
+							}
+							break;
+						}
+					}
+				}
+				munmap(m, st.st_size);
+				return found;
+			}
+
+			// set up inflating _id from its pack, if it is stored whole in one
+			bool open_packed() {
+				std::string pd = _objects + "pack/";
+				std::string pack;
+				uint64_t offset = 0;
+				if (DIR* dir = opendir(pd.c_str())) {
+					while (struct dirent* e = readdir(dir)) {
+						std::string n(e->d_name);
+						if (n.size() < 5 || n.compare(n.size() - 4, 4, ".idx")) {
+						} else if (find_in_idx(pd + n, offset)) {
+							pack = pd + n.substr(0, n.size() - 4) + ".pack";
+							break;
+						} else {
+						}
+					}
+					closedir(dir);
+				} else { untested();
+				}
+				if (pack.empty()) {
+					return false;
+				} else {
+				}
+
+				// the entry header, type and size, then the deflated data
+				unsigned char h[16];
+				int fd = open(pack.c_str(), O_RDONLY | O_CLOEXEC);
+				ssize_t k = fd < 0 ? -1 : pread(fd, h, sizeof(h), offset);
+				if (k <= 0) { untested();
+					if (fd >= 0) {
+						close(fd);
+					} else {
+					}
+					return false;
+				} else {
+				}
+				unsigned type = (h[0] >> 4) & 7;
+				uint64_t size = h[0] & 15;
+				ssize_t i = 1;
+				for (unsigned shift = 4; (h[i - 1] & 0x80) && i < k; shift += 7, ++i) {
+					size |= uint64_t(h[i] & 0x7f) << shift;
+				}
+				if (type != GIT_OBJECT_BLOB || (h[i - 1] & 0x80)) {
+					// a delta
+					close(fd);
+					return false;
+				} else {
+				}
+
+				memset(&_z, 0, sizeof(_z));
+				if (inflateInit(&_z) != Z_OK) { untested();
+					close(fd);
+					return false;
+				} else {
+				}
+				_pack = fd;
+				_data = _pos = offset + i;
+				_size = size;
+				_in.resize(64 << 10);
+				return true;
+			}
+
+			// chunk _next, into the cache. false at the end.
+			bool read_more() {
+				CHUNK c;
+				c.k = _next;
+				if (_whole) {
+					char const* p = static_cast<char const*>(git_odb_object_data(_whole));
+					uint64_t b = std::min(_size, uint64_t(_next) * _chunk);
+					uint64_t e = std::min(_size, b + _chunk);
+					c.data.assign(p + b, p + e);
+				} else if (_pack >= 0) {
+					c.data.resize(_chunk);
+					_z.next_out = reinterpret_cast<Bytef*>(c.data.data());
+					_z.avail_out = uInt(_chunk);
+					while (_z.avail_out && _z.total_out < _size) {
+						if (_z.avail_in) {
+						} else {
+							ssize_t k = pread(_pack, _in.data(), _in.size(), _pos);
+							if (k <= 0) { untested();
+								throw EXCEPTION("can't read " + _id.str() + " from its pack");
+							} else {
+							}
+							_pos += k;
+							_z.next_in = _in.data();
+							_z.avail_in = uInt(k);
+						}
+						int z = inflate(&_z, Z_NO_FLUSH);
+						if (z == Z_OK) {
+						} else if (z == Z_STREAM_END && _z.total_out == _size) {
+						} else { untested();
+							throw EXCEPTION("corrupt pack entry " + _id.str());
+						}
+					}
+					c.data.resize(_chunk - _z.avail_out);
+				} else {
+					c.data.resize(_chunk);
+					size_t have = 0;
+					while (have < _chunk) {
+						int r = git_odb_stream_read(_stream, c.data.data() + have, _chunk - have);
+						if (r < 0) { untested();
+							throw EXCEPTION("can't read " + _id.str());
+						} else if (!r) {
+							break;
+						} else {
+							have += r;
+						}
+					}
+					c.data.resize(have);
+				}
+				if (c.data.empty()) {
+					return false;
+				} else {
+				}
+
+				if (_next + 1 == _first.size()) {
+					_first.push_back(_first.back() + std::count(c.data.begin(), c.data.end(), '\n'));
+				} else {
+				}
+				++_next;
+				if (_cache.size() >= _keep) {
+					_cache.pop_front();
+				} else {
+				}
+				_cache.push_back(std::move(c));
+				return true;
+			}
+
+			// chunk k, read again if it dropped out of the cache
+			CHUNK const* chunk(size_t k) {
+				for (auto const& c : _cache) {
+					if (c.k == k) {
+						return &c;
+					} else {
+					}
+				}
+				if (k < _next) {
+					rewind();
+				} else {
+				}
+				while (_next <= k) {
+					if (!read_more()) {
+						return NULL;
+					} else {
+					}
+				}
+				return &_cache.back();
+			}
+
+		private:
+			OID _id;
+			git_odb* _odb;
+			git_odb_stream* _stream;
+			git_odb_object* _whole;
+			uint64_t _size;
+			std::string _objects;
+			int _pack; // fd, a blob stored whole in a pack
+			uint64_t _data; // where its deflated data starts
+			uint64_t _pos; // where inflating reads next
+			z_stream _z;
+			std::vector<unsigned char> _in;
+			size_t _chunk;
+			size_t _keep;
+			size_t _next; // chunk the stream is at
+			std::vector<uint64_t> _first; // line at the start of each chunk read so far
+			std::deque<CHUNK> _cache;
+	};
+
+	// the largest blobs in the history of a range, with the path and commit
+	// that introduced each.
+	//
+	// commits are ranked oldest first and handed out to a pool in that
+	// order. trees and blobs go into a sharded visited set with the rank of
+	// the commit that reached them, a tree is only descended again by an
+	// older commit, which is rare when the work goes out in order. sizes
+	// come from object headers, and each worker keeps its own top n.
+	class LARGEST_BLOBS {
+		public:
+			struct ENTRY {
+				OID id;
+				size_t size;
+				std::string path;
+				OID commit;
+			};
+		private:
+			struct SEEN {
+				uint32_t rank;
+				std::string path; // blobs only
+			};
+			struct SHARD {
+				std::mutex m;
+				std::unordered_map<OID, SEEN> s;
+			};
+			enum { _shards = 256 };
+			typedef std::pair<size_t, OID> SIZED;
+			typedef std::priority_queue<SIZED, std::vector<SIZED>, std::greater<SIZED> > TOP;
+
+		public:
+			LARGEST_BLOBS(REPO& r, size_t n, std::string const& range = "HEAD", unsigned threads = 0)
+				: _shard(_shards) {
+				// parents before children, so the older commit of two has the lower rank
+				std::vector<OID> trees;
+				for (auto c : r.commits(WALK_SPEC(range).sort(GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE))) {
+					_commits.push_back(c.oid());
+					trees.push_back(c.tree_id());
+				}
+
+				POOL pool(threads);
+				std::vector<TOP> top(pool.size());
+				{
+					POOL_REPOS repos(pool, r.path());
+					pool.run(trees.size(), [&](size_t i, unsigned w) {
+						walk(repos.repo(w), repos.odb(w), trees[i], uint32_t(i), n, top[w]);
+					});
+				}
+
+				// a blob is sized once, so it is in one heap at most
+				std::vector<SIZED> all;
+				for (auto& t : top) {
+					for (; t.size(); t.pop()) {
+						all.push_back(t.top());
+					}
+				}
+				std::sort(all.begin(), all.end(), std::greater<SIZED>());
+				for (size_t i = 0; i < all.size() && i < n; ++i) {
+					SEEN const& s = shard(all[i].second).s[all[i].second];
+					ENTRY e;
+					e.id = all[i].second;
+					e.size = all[i].first;
+					e.path = s.path;
+					e.commit = _commits[s.rank];
+					_result.push_back(e);
+				}
+			}
+
+		public:
+			// largest first
+			std::vector<ENTRY> const& result() const { return _result; }
+			// commits walked
+			size_t commits() const { return _commits.size(); }
+
+		private:
+			SHARD& shard(OID const& id) {
+				return _shard[id.get().id[0]];
+			}
+			// true if id is new, or was only reached by newer commits so far
+			bool claim(OID const& id, uint32_t rank, std::string const* path, bool& first) {
+				SHARD& s = shard(id);
+				std::lock_guard<std::mutex> l(s.m);
+				auto i = s.s.find(id);
+				first = i == s.s.end();
+				if (first) {
+					SEEN n;
+					n.rank = rank;
+					if (path) {
+						n.path = *path;
+					} else {
+					}
+					s.s.insert(std::make_pair(id, n));
+					return true;
+				} else if (rank < i->second.rank) {
+					i->second.rank = rank;
+					if (path) {
+						i->second.path = *path;
+					} else {
+					}
+					return true;
+				} else {
+					return false;
+				}
+			}
+
+			void walk(git_repository* r, git_odb* odb, OID const& root, uint32_t rank, size_t n, TOP& top) {
+				std::vector<std::pair<OID, std::string> > todo;
+				bool first;
+				if (claim(root, rank, NULL, first)) {
+					todo.push_back(std::make_pair(root, std::string()));
+				} else {
+				}
+
+				while (todo.size()) {
+					OID id = todo.back().first;
+					std::string dir = todo.back().second;
+					todo.pop_back();
+
+					git_tree* t;
+					if (git_tree_lookup(&t, r, &id.get())) { untested();
+						continue;
+					} else {
+					}
+					for (size_t i = 0; i < git_tree_entrycount(t); ++i) {
+						git_tree_entry const* e = git_tree_entry_byindex(t, i);
+						OID eid = *git_tree_entry_id(e);
+						std::string p = dir + git_tree_entry_name(e);
+						git_object_t type = git_tree_entry_type(e);
+						size_t len;
+						git_object_t h;
+
+						if (type == GIT_OBJECT_TREE) {
+							if (claim(eid, rank, NULL, first)) {
+								todo.push_back(std::make_pair(eid, p + "/"));
+							} else {
+							}
+						} else if (type != GIT_OBJECT_BLOB) {
+							// a submodule
+						} else if (!claim(eid, rank, &p, first) || !first) {
+							// sized already
+						} else if (git_odb_read_header(&len, &h, odb, &eid.get())) { untested();
+						} else if (top.size() < n) {
+							top.push(SIZED(len, eid));
+						} else if (n && top.top().first < len) {
+							top.pop();
+							top.push(SIZED(len, eid));
+						} else {
+						}
+					}
+					git_tree_free(t);
+				}
+			}
+
+		private:
+			std::vector<SHARD> _shard;
+			std::vector<OID> _commits; // oldest first
+			std::vector<ENTRY> _result;
+	};
+
+	// commits and lines added and removed per file and directory, over the
+	// commits of a walk, usually a time window (WALK_SPEC::since).
+	//
+	// each commit is diffed against its first parent on a pool, one
+	// repository handle per worker. the tree diff skips subtrees and blobs
+	// with the same id on both sides, only changed files are counted, with
+	// no context and no patch text. merges are left out, like git log
+	// --numstat does. the counts go into a trie of the path components,
+	// a directory counts a commit once however many files it touched.
+	class HOTSPOTS {
+		public:
+			struct COUNTS {
+				COUNTS() : commits(0), added(0), removed(0) {}
+				size_t commits;
+				size_t added;
+				size_t removed;
+			};
+		private:
+			struct CHANGE {
+				std::string path;
+				size_t added;
+				size_t removed;
+			};
+			struct NODE {
+				NODE() : last(size_t(-1)), file(false) {}
+				std::map<std::string, std::unique_ptr<NODE> > kids;
+				COUNTS c;
+				size_t last; // commit that counted last
+				bool file;
+			};
+
+		public:
+			HOTSPOTS(REPO& r, WALK_SPEC const& spec, unsigned threads = 0) {
+				std::vector<std::pair<OID, OID> > todo; // commit, tree
+				for (auto c : r.commits(spec)) {
+					if (c.parents() < 2) {
+						todo.push_back(std::make_pair(c.oid(), c.tree_id()));
+					} else {
+					}
+				}
+				_commits = todo.size();
+
+				POOL pool(threads);
+				std::vector<std::vector<CHANGE> > files(todo.size());
+				{
+					POOL_REPOS repos(pool, r.path());
+					pool.run(todo.size(), [&](size_t i, unsigned w) {
+						diff(repos.repo(w), todo[i].first, todo[i].second, files[i]);
+					});
+				}
+
+				for (size_t i = 0; i < files.size(); ++i) {
+					for (auto const& f : files[i]) {
+						add(f, i);
+					}
+				}
+			}
+
+		public:
+			// commits counted
+			size_t commits() const { return _commits; }
+			// the n busiest files, or directories, by commits then lines
+			std::vector<std::pair<std::string, COUNTS> > top(size_t n, bool dirs) const {
+				std::vector<std::pair<std::string, COUNTS> > all;
+				collect(_root, "", dirs, all);
+				auto busier = [](std::pair<std::string, COUNTS> const& a, std::pair<std::string, COUNTS> const& b) {
+					if (a.second.commits != b.second.commits) {
+						return a.second.commits > b.second.commits;
+					} else if (a.second.added + a.second.removed != b.second.added + b.second.removed) {
+						return a.second.added + a.second.removed > b.second.added + b.second.removed;
+					} else {
+						return a.first < b.first;
+					}
+				};
+				n = std::min(n, all.size());
+				std::partial_sort(all.begin(), all.begin() + n, all.end(), busier);
+				all.resize(n);
+				return all;
+			}
+
+		private:
+			static void diff(git_repository* r, OID const& commit, OID const& tree, std::vector<CHANGE>& out) {
+				git_commit* c;
+				git_commit* p = NULL;
+				git_tree* a = NULL;
+				git_tree* b = NULL;
+				git_diff* d = NULL;
+				git_diff_options o = GIT_DIFF_OPTIONS_INIT;
+				o.context_lines = 0;
+				o.interhunk_lines = 0;
+
+				if (git_commit_lookup(&c, r, &commit.get())) { untested();
+					throw EXCEPTION("lookup error");
+				} else if (git_commit_parentcount(c) && git_commit_parent(&p, c, 0)) { untested();
+				} else if (p && git_commit_tree(&a, p)) { untested();
+				} else if (git_tree_lookup(&b, r, &tree.get())) { untested();
+				} else if (git_diff_tree_to_tree(&d, r, a, b, &o)) { untested();
+				} else {
+					for (size_t i = 0; i < git_diff_num_deltas(d); ++i) {
+						git_diff_delta const* dd = git_diff_get_delta(d, i);
+						CHANGE f;
+						f.path = dd->new_file.path ? dd->new_file.path : dd->old_file.path;
+						f.added = f.removed = 0;
+
+						git_patch* patch;
+						size_t ctx;
+						if (git_patch_from_diff(&patch, d, i)) { untested();
+						} else if (!patch) {
+							// binary
+						} else {
+							git_patch_line_stats(&ctx, &f.added, &f.removed, patch);
+							git_patch_free(patch);
+						}
+						out.push_back(f);
+					}
+				}
+
+				git_diff_free(d);
+				git_tree_free(b);
+				git_tree_free(a);
+				git_commit_free(p);
+				git_commit_free(c);
+			}
+
+			void add(CHANGE const& f, size_t commit) {
+				NODE* n = &_root;
+				size_t b = 0;
+				for (;;) {
+					if (n->last != commit) {
+						++n->c.commits;
+						n->last = commit;
+					} else {
+					}
+					n->c.added += f.added;
+					n->c.removed += f.removed;
+
+					if (b > f.path.size()) {
+						n->file = true;
+						break;
+					} else {
+					}
+					size_t e = std::min(f.path.find('/', b), f.path.size());
+					std::unique_ptr<NODE>& k = n->kids[f.path.substr(b, e - b)];
+					if (!k) {
+						k.reset(new NODE);
+					} else {
+					}
+					n = k.get();
+					b = e + 1;
+				}
+			}
+
+			static void collect(NODE const& n, std::string const& path, bool dirs,
+					std::vector<std::pair<std::string, COUNTS> >& out) {
+				if (path.empty()) {
+				} else if (n.file != dirs) {
+					out.push_back(std::make_pair(dirs ? path + "/" : path, n.c));
+				} else {
+				}
+				for (auto const& k : n.kids) {
+					collect(*k.second, path.empty() ? k.first : path + "/" + k.first, dirs, out);
+				}
+			}
+
+		private:
+			NODE _root;
+			size_t _commits;
+	};
+
+	// commits per day, per week and per hour of the week, in the local
+	// time of the author.
+	//
+	// times, offsets and author numbers are kept in flat arrays, one entry
+	// per commit. update() only walks what HEAD gained since the last call,
+	// and starts over if HEAD moved to something not containing the old
+	// tip. a histogram is one branch free pass turning times into 32 bit
+	// seconds since a Monday, one dividing those into buckets, both plain
+	// loops the compiler vectorizes, and one pass counting.
+	class ACTIVITY {
+		public:
+			enum UNIT { _day, _week, _hour_of_week };
+			enum { hours_of_week = 7 * 24 };
+		public:
+			ACTIVITY() : _tip() {}
+		public:
+			// walk what is new on HEAD, returns the number of commits added
+			size_t update(REPO& r) {
+				git_oid head;
+				if (git_reference_name_to_id(&head, r._repo, "HEAD")) {
+					// unborn
+					clear();
+					return 0;
+				} else if (OID(head) == _tip) {
+					return 0;
+				} else if (_tip.is_zero()) {
+				} else if (git_graph_descendant_of(r._repo, &head, &_tip.get()) != 1) {
+					// rewound or rewritten
+					clear();
+				} else {
+				}
+
+				WALK_SPEC w(OID(head).str());
+				if (_tip.is_zero()) {
+				} else {
+					w.exclude(_tip.str());
+				}
+				size_t n = size();
+				for (auto c : r.commits(w)) {
+					SIGNATURE_VIEW s = c.signature_view();
+					_seconds.push_back(s.seconds());
+					_offset.push_back(int16_t(s.offset()));
+					_author.push_back(author(s));
+				}
+				_tip = OID(head);
+				return size() - n;
+			}
+			void clear() {
+				_seconds.clear();
+				_offset.clear();
+				_author.clear();
+				_authors.clear();
+				_author_ix.clear();
+				_tip = OID();
+			}
+			size_t size() const { return _seconds.size(); }
+			// "name <email>", by number
+			std::vector<std::string> const& authors() const { return _authors; }
+
+			// local time in seconds since the epoch where bucket 0 starts, a
+			// Monday 00:00. for the hour of the week, bucket 0 is Monday 0-1.
+			git_time_t first() const {
+				if (_seconds.empty()) {
+					return 0;
+				} else {
+				}
+				git_time_t lo = local(0);
+				for (size_t i = 1; i < size(); ++i) {
+					lo = std::min(lo, local(i));
+				}
+				// 1970-01-01 was a Thursday
+				git_time_t day = lo / 86400 - (lo % 86400 < 0);
+				return (day - (((day + 3) % 7 + 7) % 7)) * 86400;
+			}
+
+			// commits per bucket, those by authors whose name or email
+			// contains author if not empty. buckets for days and weeks start
+			// at first(), up to the last one with a commit.
+			std::vector<uint32_t> histogram(UNIT u, std::string const& author = "") const {
+				size_t n = size();
+				std::vector<uint32_t> b(n);
+				git_time_t base = first();
+				git_time_t const top = 0xffffffff;
+				for (size_t i = 0; i < n; ++i) {
+					git_time_t t = _seconds[i] + git_time_t(_offset[i]) * 60 - base;
+					b[i] = uint32_t(t < top ? t : top);
+				}
+				switch (u) {
+				case _day:
+					for (size_t i = 0; i < n; ++i) {
+						b[i] /= 86400;
+					}
+					break;
+				case _week:
+					for (size_t i = 0; i < n; ++i) {
+						b[i] /= 7 * 86400;
+					}
+					break;
+				case _hour_of_week:
+					for (size_t i = 0; i < n; ++i) {
+						b[i] = b[i] % (7 * 86400) / 3600;
+					}
+					break;
+				}
+
+				std::vector<char> want(_authors.size(), 1);
+				if (author.size()) {
+					for (size_t a = 0; a < _authors.size(); ++a) {
+						want[a] = _authors[a].find(author) != std::string::npos;
+					}
+				} else {
+				}
+
+				size_t m = n ? *std::max_element(b.begin(), b.end()) + size_t(1) : 0;
+				std::vector<uint32_t> h(u == _hour_of_week ? size_t(hours_of_week) : m);
+				for (size_t i = 0; i < n; ++i) {
+					h[b[i]] += want[_author[i]];
+				}
+				return h;
+			}
+
+		private:
+			git_time_t local(size_t i) const {
+				return _seconds[i] + git_time_t(_offset[i]) * 60;
+			}
+			uint32_t author(SIGNATURE_VIEW const& s) {
+				std::string a = s.name().str() + " <" + s.email().str() + ">";
+				auto i = _author_ix.insert(std::make_pair(a, uint32_t(_authors.size())));
+				if (i.second) {
+					_authors.push_back(a);
+				} else {
+				}
+				return i.first->second;
+			}
+
+		private:
+			std::vector<git_time_t> _seconds;
+			std::vector<int16_t> _offset; // minutes east of UTC
+			std::vector<uint32_t> _author;
+			std::vector<std::string> _authors;
+			std::unordered_map<std::string, uint32_t> _author_ix;
+			OID _tip; // HEAD at the last update, zero before
+	};
+
+	// a clone of a local repository, with the objects hardlinked instead of
+	// copied where the file system allows it.
+	//
+	// the working tree is optional. the top of the tree is cut into
+	// disjoint paths, dealt out to groups, and each group is checked out by
+	// a thread with its own repository, without touching the index. the
+	// index is then read from the tree, given the stat data of the files
+	// just written and written once.
+	class CLONE {
+		public:
+			CLONE(REPO const& src, std::string const& path, bool checkout, unsigned threads = 0)
+				: _files(0) {
+				git_clone_options o = GIT_CLONE_OPTIONS_INIT;
+				o.local = GIT_CLONE_LOCAL;
+				o.checkout_opts.checkout_strategy = GIT_CHECKOUT_NONE;
+
+				git_repository* r;
+				if (git_clone(&r, src.path().c_str(), path.c_str(), &o)) {
+					throw EXCEPTION("clone error: " + std::string(giterr_last()->message));
+				} else if (!checkout || git_repository_is_bare(r)) {
+				} else {
+					try {
+						this->checkout(r, threads);
+					}
+					catch (...) { untested();
+						git_repository_free(r);
+						throw;
+					}
+				}
+				git_repository_free(r);
+			}
+
+		public:
+			// files in the working tree, 0 without one
+			size_t files() const { return _files; }
+
+		private:
+			void checkout(git_repository* r, unsigned threads) {
+				git_object* tree;
+				if (git_revparse_single(&tree, r, "HEAD^{tree}")) {
+					// unborn, nothing to check out
+					return;
+				} else {
+				}
+				std::string workdir = git_repository_workdir(r);
+
+				POOL pool(threads);
+				size_t n = 4 * pool.size();
+				std::vector<std::vector<std::string> > groups(n);
+				std::vector<std::string> paths = split(r, (git_tree*)tree, n);
+				for (size_t i = 0; i < paths.size(); ++i) {
+					groups[i % n].push_back(paths[i]);
+				}
+
+				POOL_REPOS repos(pool, workdir);
+				std::vector<int> err(n, 0);
+				pool.run(n, [&](size_t i, unsigned w) {
+					git_object* t;
+					if (groups[i].empty()) {
+						return;
+					} else if (git_revparse_single(&t, repos.repo(w), "HEAD^{tree}")) { untested();
+						throw EXCEPTION("can't find HEAD");
+					} else {
+					}
+
+					std::vector<char*> p;
+					for (auto& s : groups[i]) {
+						p.push_back(const_cast<char*>(s.c_str()));
+					}
+					git_checkout_options o = GIT_CHECKOUT_OPTIONS_INIT;
+					// the working tree is new, nothing to keep
+					o.checkout_strategy = GIT_CHECKOUT_FORCE
+						| GIT_CHECKOUT_DONT_UPDATE_INDEX | GIT_CHECKOUT_DONT_WRITE_INDEX
+						| GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+					o.paths.strings = p.data();
+					o.paths.count = p.size();
+					err[i] = git_checkout_tree(repos.repo(w), t, &o);
+					git_object_free(t);
+				});
+				for (int e : err) {
+					if (e) { untested();
+						git_object_free(tree);
+						throw EXCEPTION("checkout error " + std::to_string(e));
+					} else {
+					}
+				}
+
+				git_index* ix;
+				if (git_repository_index(&ix, r)) { untested();
+					git_object_free(tree);
+					throw EXCEPTION("can't open index");
+				} else if (git_index_read_tree(ix, (git_tree*)tree)) { untested();
+				} else {
+					_files = git_index_entrycount(ix);
+					for (size_t i = 0; i < _files; ++i) {
+						git_index_entry e = *git_index_get_byindex(ix, i);
+						std::string path = e.path;
+						struct stat st;
+						if (lstat((workdir + path).c_str(), &st)) { untested();
+							continue;
+						} else {
+						}
+						e.path = path.c_str();
+						e.ctime.seconds = int32_t(st.st_ctim.tv_sec);
+						e.ctime.nanoseconds = uint32_t(st.st_ctim.tv_nsec);
+						e.mtime.seconds = int32_t(st.st_mtim.tv_sec);
+						e.mtime.nanoseconds = uint32_t(st.st_mtim.tv_nsec);
+						e.dev = uint32_t(st.st_dev);
+						e.ino = uint32_t(st.st_ino);
+						e.uid = st.st_uid;
+						e.gid = st.st_gid;
+						e.file_size = uint32_t(st.st_size);
+						git_index_add(ix, &e);
+					}
+					git_index_write(ix);
+				}
+				git_index_free(ix);
+				git_object_free(tree);
+			}
+
+			// disjoint paths covering the tree, directories split until
+			// there are n or the tree is too shallow for that
+			static std::vector<std::string> split(git_repository* r, git_tree* tree, size_t n) {
+				std::vector<std::string> out;
+				std::vector<std::pair<std::string, OID> > dirs;
+				add(tree, "", out, dirs);
+				for (unsigned depth = 0; depth < 8 && dirs.size() && out.size() + dirs.size() < n; ++depth) {
+					std::vector<std::pair<std::string, OID> > next;
+					for (auto const& d : dirs) {
+						git_tree* t;
+						if (git_tree_lookup(&t, r, &d.second.get())) { untested();
+							out.push_back(d.first);
+						} else {
+							add(t, d.first + "/", out, next);
+							git_tree_free(t);
+						}
+					}
+					dirs.swap(next);
+				}
+				for (auto const& d : dirs) {
+					out.push_back(d.first);
+				}
+				return out;
+			}
+			static void add(git_tree* t, std::string const& prefix, std::vector<std::string>& out,
+					std::vector<std::pair<std::string, OID> >& dirs) {
+				for (size_t i = 0; i < git_tree_entrycount(t); ++i) {
+					git_tree_entry const* e = git_tree_entry_byindex(t, i);
+					std::string p = prefix + git_tree_entry_name(e);
+					if (git_tree_entry_type(e) == GIT_OBJECT_TREE) {
+						dirs.push_back(std::make_pair(p, OID(*git_tree_entry_id(e))));
+					} else {
+						out.push_back(p);
+					}
+				}
+			}
+
+		private:
+			size_t _files;
+	};
+
+	// packs the loose objects into one new pack with git_packbuilder on all
+	// cores, then removes the loose files, as "git repack -d" and "git
+	// prune-packed" would for objects that are in no pack yet.
+	class REPACK {
+		public:
+			// stage, done, total. called from libgit2, one call at a time.
+			typedef std::function<void(char const*, size_t, size_t)> PROGRESS;
+		public:
+			REPACK(REPO& r, unsigned threads = 0, PROGRESS progress = PROGRESS())
+				: _objects(0), _percent(size_t(-1)), _progress(progress) {
+				static char const hex[] = "0123456789abcdef";
+				std::string objects = r.path() + "objects/";
+				POOL pool(threads);
+
+				// the loose objects, one fan-out directory per task
+				std::vector<std::vector<git_oid> > ids(256);
+				pool.run(256, [&](size_t i, unsigned) {
+					std::string d = objects + hex[i >> 4] + hex[i & 15] + "/";
+					DIR* dir = opendir(d.c_str());
+					if (!dir) {
+						return;
+					} else {
+					}
+					char name[GIT_OID_HEXSZ + 1] = { hex[i >> 4], hex[i & 15] };
+					while (struct dirent* e = readdir(dir)) {
+						git_oid id;
+						if (strlen(e->d_name) != GIT_OID_HEXSZ - 2) {
+							// ".", "..", tmp_obj_*
+						} else {
+							memcpy(name + 2, e->d_name, GIT_OID_HEXSZ - 2);
+							name[GIT_OID_HEXSZ] = '\0';
+							if (git_oid_fromstr(&id, name)) { untested();
+							} else {
+								ids[i].push_back(id);
+							}
+						}
+					}
+					closedir(dir);
+				});
+				for (auto const& d : ids) {
+					_objects += d.size();
+				}
+				if (!_objects) {
+					return;
+				} else {
+				}
+
+				git_packbuilder* pb;
+				if (git_packbuilder_new(&pb, r._repo)) { untested();
+					throw EXCEPTION("can't make a packbuilder");
+				} else {
+				}
+				git_packbuilder_set_threads(pb, pool.size());
+				git_packbuilder_set_callbacks(pb, built, this);
+
+				int err = 0;
+				for (auto const& d : ids) {
+					for (auto const& id : d) {
+						if (err) {
+						} else if ((err = git_packbuilder_insert(pb, &id, NULL))) { untested();
+						} else {
+						}
+					}
+				}
+				if (err) { untested();
+				} else {
+					err = git_packbuilder_write(pb, (objects + "pack").c_str(), 0, indexed, this);
+				}
+				git_packbuilder_free(pb);
+				if (err) { untested();
+					throw EXCEPTION("repack error: " + std::string(giterr_last()->message));
+				} else {
+				}
+
+				// all in the pack now
+				pool.run(256, [&](size_t i, unsigned) {
+					std::string d = objects + hex[i >> 4] + hex[i & 15] + "/";
+					char name[GIT_OID_HEXSZ];
+					for (auto const& id : ids[i]) {
+						git_oid_fmt(name, &id);
+						unlink((d + std::string(name + 2, GIT_OID_HEXSZ - 2)).c_str());
+					}
+					// unless something else is in there
+					rmdir(d.c_str());
+				});
+			}
+
+		public:
+			// objects packed
+			size_t objects() const { return _objects; }
+		private:
+			static int built(int stage, uint32_t done, uint32_t total, void* p) {
+				REPACK* x = static_cast<REPACK*>(p);
+				if (x->_progress) {
+					x->_progress(stage == GIT_PACKBUILDER_ADDING_OBJECTS ? "counting" : "compressing",
+							done, total);
+				} else {
+				}
+				return 0;
+			}
+			static int indexed(git_indexer_progress const* s, void* p) {
+				REPACK* x = static_cast<REPACK*>(p);
+				// once per percent
+				size_t pc = s->total_objects ? size_t(s->indexed_objects) * 100 / s->total_objects : 100;
+				if (!x->_progress || pc == x->_percent) {
+				} else {
+					x->_percent = pc;
+					x->_progress("writing", s->indexed_objects, s->total_objects);
+				}
+				return 0;
+			}
+		private:
+			size_t _objects;
+			size_t _percent;
+			PROGRESS _progress;
+	};
+
+	// adds what matches pathspecs to the index, as "git add" does: new and
+	// modified files are added, deleted ones removed, ignored ones left
+	// out. a pathspec is a file, a directory or a glob, where "*" also
+	// matches "/". "." is everything.
+	//
+	// the working tree below the pathspecs is walked on all cores. files
+	// whose stat data matches the index are left alone, the others are
+	// hashed and written to the object store on a POOL, each worker with
+	// its own repository. the entries then go into the index in one batch,
+	// and the index is written once.
+	class STAGE {
+		private:
+			struct ITEM {
+				ITEM() : add(false) {}
+				struct stat st;
+				git_oid id;
+				bool add;
+			};
+			typedef std::unordered_map<std::string, git_index_entry const*> tracked_t;
+
+		public:
+			STAGE(REPO& r, std::vector<std::string> const& pathspecs, unsigned threads = 0)
+				: _unchanged(0) {
+				std::string wd = r.workdir();
+				if (wd.empty()) {
+					throw EXCEPTION_INVALID("bare repository");
+				} else {
+				}
+				std::vector<std::string> specs;
+				for (std::string s : pathspecs) {
+					if (!s.compare(0, 2, "./")) {
+						s.erase(0, 2);
+					} else {
+					}
+					while (s.size() && s.back() == '/') {
+						s.pop_back();
+					}
+					specs.push_back(s == "." ? "" : s);
+				}
+
+				git_index* ix;
+				if (git_repository_index(&ix, r._repo)) { untested();
+					throw EXCEPTION("can't open index");
+				} else if (git_index_read(ix, 0)) { untested();
+					git_index_free(ix);
+					throw EXCEPTION("can't read index");
+				} else {
+				}
+				struct stat st;
+				int64_t racy = stat(git_index_path(ix), &st) ? 0 : int64_t(st.st_mtim.tv_sec);
+				tracked_t tracked;
+				for (size_t i = 0; i < git_index_entrycount(ix); ++i) {
+					git_index_entry const* e = git_index_get_byindex(ix, i);
+					if (GIT_INDEX_ENTRY_STAGE(e) == 0) {
+						tracked[e->path] = e;
+					} else {
+					}
+				}
+
+				POOL pool(threads);
+				std::vector<std::string> paths = walk(wd, specs, pool);
+
+				// hash what changed
+				std::vector<ITEM> items(paths.size());
+				std::vector<size_t> same(pool.size(), 0);
+				POOL_REPOS repos(pool, wd);
+				pool.run(paths.size(), [&](size_t i, unsigned w) {
+					std::string const& p = paths[i];
+					ITEM& x = items[i];
+					auto t = tracked.find(p);
+					int ignored = 0;
+					git_repository* wr = repos.repo(w);
+
+					if (lstat((wd + p).c_str(), &x.st)) { untested();
+						// gone meanwhile
+					} else if (t != tracked.end() && !stat_differs(t->second, x.st, racy)) {
+						++same[w];
+					} else if (t == tracked.end()
+							&& (git_status_should_ignore(&ignored, wr, p.c_str()) || ignored)) {
+					} else if (git_blob_create_fromworkdir(&x.id, wr, p.c_str())) { untested();
+						throw EXCEPTION("can't add " + p + ": " + giterr_last()->message);
+					} else {
+						x.add = true;
+					}
+				});
+				for (unsigned w = 0; w < pool.size(); ++w) {
+					_unchanged += same[w];
+				}
+
+				// tracked, but no longer there
+				for (auto const& t : tracked) {
+					if (!matches(specs, t.first)) {
+					} else if (std::binary_search(paths.begin(), paths.end(), t.first)) {
+					} else if (!lstat((wd + t.first).c_str(), &st)) {
+						// a submodule, or in a directory not walked
+					} else {
+						_removed.push_back(t.first);
+					}
+				}
+				std::sort(_removed.begin(), _removed.end());
+
+				// one batch. a path is looked up in tracked before its entry is
+				// replaced.
+				bool conflicts = git_index_has_conflicts(ix);
+				bool refreshed = false;
+				int err = 0;
+				for (size_t i = 0; i < paths.size(); ++i) {
+					ITEM const& x = items[i];
+					if (!x.add || err) {
+						continue;
+					} else {
+					}
+					auto t = tracked.find(paths[i]);
+					if (t == tracked.end() || !git_oid_equal(&t->second->id, &x.id)) {
+						_added.push_back(paths[i]);
+					} else {
+						// same content, new stat data
+						++_unchanged;
+						refreshed = true;
+					}
+
+					git_index_entry e;
+					memset(&e, 0, sizeof(e));
+					e.ctime.seconds = int32_t(x.st.st_ctim.tv_sec);
+					e.ctime.nanoseconds = uint32_t(x.st.st_ctim.tv_nsec);
+					e.mtime.seconds = int32_t(x.st.st_mtim.tv_sec);
+					e.mtime.nanoseconds = uint32_t(x.st.st_mtim.tv_nsec);
+					e.dev = uint32_t(x.st.st_dev);
+					e.ino = uint32_t(x.st.st_ino);
+					e.mode = S_ISLNK(x.st.st_mode) ? GIT_FILEMODE_LINK
+						: (x.st.st_mode & S_IXUSR) ? GIT_FILEMODE_BLOB_EXECUTABLE : GIT_FILEMODE_BLOB;
+					e.uid = x.st.st_uid;
+					e.gid = x.st.st_gid;
+					e.file_size = uint32_t(x.st.st_size);
+					e.id = x.id;
+					e.path = paths[i].c_str();
+					if (conflicts) {
+						git_index_conflict_remove(ix, e.path);
+					} else {
+					}
+					err = git_index_add(ix, &e);
+				}
+				for (auto const& p : _removed) {
+					if (!err) {
+						err = git_index_remove_bypath(ix, p.c_str());
+					} else { untested();
+					}
+				}
+				if (err) { untested();
+				} else if (_added.size() || _removed.size() || refreshed) {
+					err = git_index_write(ix);
+				} else {
+				}
+				git_index_free(ix);
+				if (err) { untested();
+					throw EXCEPTION("index error: " + std::string(giterr_last()->message));
+				} else {
+				}
+			}
+
+		public:
+			// new or changed files, sorted
+			std::vector<std::string> const& added() const { return _added; }
+			// deleted files, sorted
+			std::vector<std::string> const& removed() const { return _removed; }
+			// matching files that did not change
+			size_t unchanged() const { return _unchanged; }
+
+		private:
+			static bool matches(std::string const& spec, std::string const& path) {
+				if (spec.empty()) {
+					return true;
+				} else if (!path.compare(0, spec.size(), spec)
+						&& (path.size() == spec.size() || path[spec.size()] == '/')) {
+					return true;
+				} else {
+					return !fnmatch(spec.c_str(), path.c_str(), 0);
+				}
+			}
+			static bool matches(std::vector<std::string> const& specs, std::string const& path) {
+				for (auto const& s : specs) {
+					if (matches(s, path)) {
+						return true;
+					} else {
+					}
+				}
+				return false;
+			}
+
+			// files below the pathspecs, sorted. one directory per task,
+			// without .git and repositories inside this one.
+			static std::vector<std::string> walk(std::string const& wd,
+					std::vector<std::string> const& specs, POOL& pool) {
+				std::vector<std::string> dirs;
+				std::vector<std::vector<std::string> > found(pool.size());
+				struct stat st;
+				for (auto const& s : specs) {
+					size_t g = s.find_first_of("*?[");
+					if (g != std::string::npos) {
+						// the directory the glob starts in
+						size_t d = s.rfind('/', g);
+						dirs.push_back(d == std::string::npos ? "" : s.substr(0, d + 1));
+					} else if (s.empty()) {
+						dirs.push_back("");
+					} else if (lstat((wd + s).c_str(), &st)) {
+						// removed, if tracked
+					} else if (S_ISDIR(st.st_mode)) {
+						dirs.push_back(s + "/");
+					} else {
+						found[0].push_back(s);
+					}
+				}
+				// not below another one
+				std::sort(dirs.begin(), dirs.end());
+				std::vector<std::string> seeds;
+				for (auto const& d : dirs) {
+					if (seeds.size() && !d.compare(0, seeds.back().size(), seeds.back())) {
+					} else {
+						seeds.push_back(d);
+					}
+				}
+
+				pool.run_tasks(seeds, [&](std::string const& d, unsigned w,
+							std::function<void(std::string const&)>& push) {
+					DIR* dir = opendir((wd + d).c_str());
+					if (!dir) {
+						return;
+					} else {
+					}
+					struct stat st;
+					while (struct dirent* e = readdir(dir)) {
+						std::string n(e->d_name);
+						std::string p = d + n;
+						bool isdir = e->d_type == DT_DIR;
+						if (e->d_type == DT_UNKNOWN && !lstat((wd + p).c_str(), &st)) { untested();
+							isdir = S_ISDIR(st.st_mode);
+						} else {
+						}
+
+						if (n == "." || n == ".." || n == ".git") {
+						} else if (!isdir) {
+							if (matches(specs, p)) {
+								found[w].push_back(p);
+							} else {
+							}
+						} else if (access((wd + p + "/.git").c_str(), F_OK)) {
+							push(p + "/");
+						} else {
+							// another repository
+						}
+					}
+					closedir(dir);
+				});
+
+				std::vector<std::string> all;
+				for (auto const& f : found) {
+					all.insert(all.end(), f.begin(), f.end());
+				}
+				std::sort(all.begin(), all.end());
+				all.erase(std::unique(all.begin(), all.end()), all.end());
+				return all;
+			}
+
+		private:
+			std::vector<std::string> _added;
+			std::vector<std::string> _removed;
+			size_t _unchanged;
+	};
+
+	inline BRANCHES REPO::branches()
+	{
+		return BRANCHES(*this);
+	}
+
+	inline CONFIG::CONFIG(REPO& r) // : _repo(r)
+	{
+		if (git_repository_config(&_cfg, r._repo)) {
+			throw EXCEPTION("can't open config for repo");
+		} else {
+		}
+	}
+	// ---------------------------------------------------------------------------- //
+	inline COMMITS::COMMITS(REPO& r, WALK_SPEC const& spec)
+		: _repo(r), _spec(spec), _cur(NULL), _kept(0), _old(0), _done(false)
+	{
+		git_revwalk_new(&_walk, _repo._repo);
+		git_revwalk_sorting(_walk, _spec.sort());
+		if (_spec.first_parent()) {
+			git_revwalk_simplify_first_parent(_walk);
+		} else {
+		}
+
+		try {
+			auto const& in = _spec.includes();
+			if (in.empty()) {
+				push("HEAD", true);
+			} else {
+				for (auto const& i : in) {
+					push(i, in.size() == 1);
+				}
+			}
+			for (auto const& x : _spec.excludes()) {
+				hide(x);
+			}
+		}
+		catch (...) {
+			git_revwalk_free(_walk);
+			throw;
+		}
+	}
+
+	// only: an unresolvable HEAD is an empty walk, not an error
+	inline void COMMITS::push(std::string const& range, bool only)
+	{
+		int error;
+		git_object *obj;
+
+		if (!_walk) {
+		} else if (range.find("..") != std::string::npos) {
+			if (git_revwalk_push_range(_walk, range.c_str())) {
+				throw EXCEPTION_INVALID("range " + range);
+			} else {
+			}
+		} else if (is_abbrev(range)) {
+			// skip revparse, it tries refs first
+			OID id = _repo.resolve(range);
+			git_odb* odb;
+			size_t len;
+			git_object_t type = GIT_OBJECT_INVALID;
+			if (!git_repository_odb(&odb, _repo._repo)) {
+				if (git_odb_read_header(&len, &type, odb, &id.get())) { untested();
+				} else {
+				}
+				git_odb_free(odb);
+			} else { untested();
+			}
+			if (type != GIT_OBJECT_COMMIT && type != GIT_OBJECT_TAG) {
+				throw EXCEPTION_INVALID("revision " + range + ", not a commit");
+			} else if (git_revwalk_push(_walk, &id.get())) {
+				// a tag of something else
+				throw EXCEPTION_INVALID("revision " + range);
+			} else {
+			}
+		} else if ((error = git_revparse_single(&obj, _repo._repo, range.c_str())) < 0) {
+			if (range == "HEAD" && only) {
+				// cannot resolve HEAD.
+				git_revwalk_free(_walk);
+				_walk = nullptr;
+			} else {
+				throw EXCEPTION_CANT_FIND(range);
+			}
+		} else {
+			error = git_revwalk_push(_walk, git_object_id(obj));
+			git_object_free(obj);
+
+			if (error) { untested();
+				throw EXCEPTION_INVALID("revision " + range);
+			} else {
+			}
+		}
+	}
+
+	inline void COMMITS::hide(std::string const& rev)
+	{
+		git_object *obj;
+		if (!_walk) {
+		} else if (git_revparse_single(&obj, _repo._repo, rev.c_str()) < 0) {
+			throw EXCEPTION_CANT_FIND(rev);
+		} else {
+			int error = git_revwalk_hide(_walk, git_object_id(obj));
+			git_object_free(obj);
+			if (error) { untested();
+				throw EXCEPTION_INVALID("revision " + rev);
+			} else {
+			}
+		}
+	}
+
+	// commits come newest first unless sorted otherwise. git allows for a
+	// few skewed clocks before it gives up at since, so does this.
+	inline bool COMMITS::next(git_oid& id)
+	{
+		unsigned const slop = 5;
+		bool const timed = !(_spec.sort() & (GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE));
+
+		git_commit_free(_cur);
+		_cur = NULL;
+		if (!_walk || _done) {
+			return false;
+		} else if (_spec.max_count() && _kept >= _spec.max_count()) {
+			_done = true;
+			return false;
+		} else {
+		}
+
+		while (!git_revwalk_next(&id, _walk)) {
+			if (!_spec.filters()) {
+				++_kept;
+				return true;
+			} else if (git_commit_lookup(&_cur, _repo._repo, &id)) { untested();
+				_cur = NULL;
+				throw EXCEPTION("lookup error");
+			} else {
+			}
+
+			git_time_t t = git_commit_time(_cur);
+			bool keep = true;
+			if (!_spec.since() || t >= _spec.since()) {
+				_old = 0;
+			} else if (timed && ++_old >= slop) {
+				_done = true;
+				break;
+			} else {
+				keep = false;
+			}
+
+			if (!keep) {
+			} else if (_spec.until() && t > _spec.until()) {
+				keep = false;
+			} else if (_spec.author().empty()) {
+			} else {
+				git_signature const* a = git_commit_author(_cur);
+				keep = strstr(a->name, _spec.author().c_str())
+					|| strstr(a->email, _spec.author().c_str());
+			}
+
+			if (keep) {
+				++_kept;
+				return true;
+			} else {
+				git_commit_free(_cur);
+				_cur = NULL;
+			}
+		}
+
+		git_commit_free(_cur);
+		_cur = NULL;
+		return false;
+	}
+
+	inline bool COMMITS::is_abbrev(std::string const& r) const
+	{
+		git_reference* ref;
+		if (r.size() < 4 || r.size() >= GIT_OID_HEXSZ
+				|| r.find_first_not_of("0123456789abcdef") != std::string::npos) {
+			return false;
+		} else if (!git_reference_dwim(&ref, _repo._repo, r.c_str())) { untested();
+			git_reference_free(ref);
+			return false;
+		} else {
+			return true;
+		}
+	}
+
+	inline COMMIT COMMITS::COMMIT_WALKER::operator*()
+	{
+		if (git_commit* c = _c->_cur) {
+			// the filters looked it up already
+			_c->_cur = NULL;
+			return COMMIT(c);
+		} else {
+			return COMMIT(_id, _c->_repo._repo);
+		}
+	}
+
+	inline CONFIG::ITEM CONFIG::ITER::operator*()
+	{
+		return CONFIG::ITEM(_e, _i, _cfg);
+	}
+
+	static int resolve_refish(git_annotated_commit **commit, git_repository *repo, const char *refish)
+	{
+		git_reference *ref;
+		git_object *obj;
+		int err = 0;
+
+		assert(commit != NULL);
+
+		err = git_reference_dwim(&ref, repo, refish);
+		assert(ref);
+
+		if (err == GIT_OK) {
+			git_annotated_commit_from_ref(commit, repo, ref);
+			//	git_reference_free(ref); memory leak
+			return 0;
+		} else {
+		}
+
+		err = git_revparse_single(&obj, repo, refish);
+		if (err == GIT_OK) {
+			err = git_annotated_commit_lookup(commit, repo, git_object_id(obj));
+			//	git_object_free(obj); memory leak
+		} else {
+		}
+
+		return err;
+	}
+
+	// ---------------------------------------------------------------------------- //
+	// modification times of the object directories. if none of them changed,
+	// neither did the object store.
+	static std::vector<int64_t> objects_stamp(std::string const& objects)
+	{
+		static char const hex[] = "0123456789abcdef";
+		std::vector<int64_t> stamp;
+		struct stat st;
+
+		for (int i = -1; i < 256; ++i) {
+			std::string d = objects;
+			if (i < 0) {
+				d += "pack";
+			} else {
+				d += std::string(1, hex[i >> 4]) + hex[i & 15];
+			}
+
+			if (stat(d.c_str(), &st)) {
+				stamp.push_back(0);
+			} else {
+				stamp.push_back(int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec);
+			}
+		}
+
+		return stamp;
+	}
+
+	static int collect_oid(git_oid const* id, void* payload)
+	{
+		static_cast<std::vector<git_oid>*>(payload)->push_back(*id);
+		return 0;
+	}
+
+	// computed once per state of the object store, cached by directory mtimes.
+	inline STATS REPO::stats()
+	{
+		// daemon workers come here for different repositories at once
+		static std::mutex m;
+		static std::map<std::string, std::pair<std::vector<int64_t>, STATS> > cache;
+		std::string objects = path() + "objects/";
+		std::vector<int64_t> stamp = objects_stamp(objects);
+
+		{
+			std::lock_guard<std::mutex> l(m);
+			auto c = cache.find(objects);
+			if (c != cache.end() && c->second.first == stamp) {
+				PROFILE::count("stats cache", true);
+				return c->second.second;
+			} else {
+				PROFILE::count("stats cache", false);
+			}
+		}
+
+		STATS s;
+		POOL pool;
+
+		// loose objects. one fan-out directory per task
+		std::vector<size_t> lcount(256, 0);
+		std::vector<uint64_t> lsize(256, 0);
+		pool.run(256, [&](size_t i, unsigned) {
+			static char const hex[] = "0123456789abcdef";
+			std::string d = objects + hex[i >> 4] + hex[i & 15] + "/";
+			DIR* dir = opendir(d.c_str());
+			if (!dir) {
+				return;
+			} else {
+			}
+
+			struct stat st;
+			while (struct dirent* e = readdir(dir)) {
+				if (strlen(e->d_name) != GIT_OID_HEXSZ - 2
+						|| strspn(e->d_name, hex) != GIT_OID_HEXSZ - 2) {
+					// ".", "..", tmp_obj_*, as REPACK
+				} else if (stat((d + e->d_name).c_str(), &st)) { untested();
+				} else {
+					++lcount[i];
+					lsize[i] += st.st_size;
+				}
+			}
+			closedir(dir);
+		});
+		for (size_t i = 0; i < 256; ++i) {
+			s._loose_count += lcount[i];
+			s._loose_size += lsize[i];
+		}
+
+		// packs
+		std::string pd = objects + "pack/";
+		if (DIR* dir = opendir(pd.c_str())) {
+			struct stat st;
+			struct stat sti;
+			while (struct dirent* e = readdir(dir)) {
+				std::string n(e->d_name);
+				if (n.size() < 5 || n.compare(n.size() - 5, 5, ".pack")) {
+				} else if (stat((pd + n).c_str(), &st)) { untested();
+				} else {
+					std::string idx = pd + n.substr(0, n.size() - 5) + ".idx";
+					uint64_t is = stat(idx.c_str(), &sti) ? 0 : sti.st_size;
+					s._packs.push_back(STATS::PACK(n, st.st_size, is));
+					s._pack_size += st.st_size + is;
+				}
+			}
+			closedir(dir);
+		} else { untested();
+		}
+
+		// objects by type. enumerate once, then read headers in parallel, one
+		// repository handle per worker.
+		git_odb* odb;
+		std::vector<git_oid> ids;
+		if (git_repository_odb(&odb, _repo)) { untested();
+			throw EXCEPTION("can't open object database");
+		} else if (git_odb_foreach(odb, collect_oid, &ids)) { untested();
+			git_odb_free(odb);
+			throw EXCEPTION("can't enumerate objects");
+		} else {
+			git_odb_free(odb);
+		}
+
+		// objects that are both loose and packed count once.
+		std::sort(ids.begin(), ids.end(), [](git_oid const& a, git_oid const& b) {
+			return git_oid_cmp(&a, &b) < 0;
+		});
+		ids.erase(std::unique(ids.begin(), ids.end(), [](git_oid const& a, git_oid const& b) {
+			return git_oid_equal(&a, &b);
+		}), ids.end());
+
+		std::vector<std::vector<size_t> > wc(pool.size(), std::vector<size_t>(STATS::_types, 0));
+		size_t const chunk = 4096;
+		POOL_REPOS repos(pool, path());
+		pool.run((ids.size() + chunk - 1) / chunk, [&](size_t k, unsigned w) {
+			git_odb* odb = repos.odb(w);
+			size_t len;
+			git_object_t t;
+			for (size_t i = k * chunk; i < ids.size() && i < (k + 1) * chunk; ++i) {
+				if (git_odb_read_header(&len, &t, odb, &ids[i])) { untested();
+				} else if (t > 0 && int(t) < STATS::_types) {
+					++wc[w][t];
+				} else { untested();
+				}
+			}
+		});
+		for (unsigned w = 0; w < pool.size(); ++w) {
+			for (int t = 0; t < STATS::_types; ++t) {
+				s._count[t] += wc[w][t];
+			}
+		}
+
+		std::lock_guard<std::mutex> l(m);
+		cache[objects] = std::make_pair(stamp, s);
+		return s;
+	}
+
+	// built once, and again when objects were added.
+	inline std::shared_ptr<OID_INDEX const> REPO::oid_index(bool build)
+	{
+		// daemon workers come here for different repositories at once
+		static std::mutex m;
+		static std::map<std::string, std::pair<std::vector<int64_t>,
+			std::shared_ptr<OID_INDEX const> > > cache;
+		std::string objects = path() + "objects/";
+		std::vector<int64_t> stamp = objects_stamp(objects);
+
+		{
+			std::lock_guard<std::mutex> l(m);
+			auto c = cache.find(objects);
+			if (c != cache.end() && c->second.first == stamp) {
+				PROFILE::count("oid index", true);
+				return c->second.second;
+			} else {
+				PROFILE::count("oid index", false);
+			}
+		}
+
+		if (!build) {
+			return std::shared_ptr<OID_INDEX const>();
+		} else {
+		}
+		std::shared_ptr<OID_INDEX const> x(new OID_INDEX(objects));
+		std::lock_guard<std::mutex> l(m);
+		cache[objects] = std::make_pair(stamp, x);
+		return x;
+	}
+
+	// building the index for one lookup would read all pack indexes
+	inline OID REPO::resolve(std::string const& prefix)
+	{
+		if (auto x = oid_index(false)) {
+			return x->resolve(prefix);
+		} else {
+		}
+
+		git_oid p;
+		git_oid id;
+		git_odb* odb;
+		if (prefix.size() < 4 || prefix.size() > GIT_OID_HEXSZ
+				|| git_oid_fromstrn(&p, prefix.c_str(), prefix.size())) {
+			throw EXCEPTION_INVALID("object id " + prefix);
+		} else if (git_repository_odb(&odb, _repo)) { untested();
+			throw EXCEPTION("can't open object database");
+		} else {
+		}
+		int e = git_odb_exists_prefix(&id, odb, &p, prefix.size());
+		git_odb_free(odb);
+		if (e == GIT_EAMBIGUOUS) {
+			throw EXCEPTION_INVALID("ambiguous " + prefix);
+		} else if (e) {
+			throw EXCEPTION_CANT_FIND(prefix);
+		} else {
+			return id;
+		}
+	}
+
+	// rendered views kept between runs, one file per view, good while the
+	// parts of the repository it was made from are unchanged.
+	//
+	// the key hashes the view parameters and the state of its inputs: the
+	// ref ids, config and index times, the object directory times. files
+	// are kept in .git/hci-cache, or in the XDG cache directory if .git
+	// can't be written, and are mapped when read.
+	class VIEW_STORE {
+		public:
+			enum {
+				_head = NOTIFY::_head,
+				_refs = NOTIFY::_refs,
+				_config = NOTIFY::_config,
+				_index = NOTIFY::_index,
+				_objects = 16
+			};
+			// a stored view, mapped
+			class MAPPED {
+				public:
+					MAPPED(void* m, size_t n, size_t skip) : _m(m), _n(n), _skip(skip) {}
+					~MAPPED() {
+						munmap(_m, _n);
+					}
+				private:
+					MAPPED(MAPPED const&);
+					MAPPED& operator=(MAPPED const&);
+				public:
+					STRING_VIEW data() const {
+						return STRING_VIEW(static_cast<char const*>(_m) + _skip, _n - _skip);
+					}
+				private:
+					void* _m;
+					size_t _n;
+					size_t _skip;
+			};
+		private:
+			// magic, key, size
+			enum { _header = 24 };
+
+		public:
+			explicit VIEW_STORE(REPO& r) : _repo(r) {
+				std::string g = r.path();
+				if (!access(g.c_str(), W_OK)) {
+					_dir = g + "hci-cache/";
+				} else if (char const* x = getenv("XDG_CACHE_HOME")) { untested();
+					_dir = std::string(x) + "/git-repo-cli/" + hex(fnv(g.data(), g.size())) + "/";
+				} else if (char const* h = getenv("HOME")) { untested();
+					_dir = std::string(h) + "/.cache/git-repo-cli/" + hex(fnv(g.data(), g.size())) + "/";
+				} else { untested();
+					// nowhere to keep them
+				}
+			}
+
+		public:
+			// the state of inputs, with params
+			uint64_t key(std::string const& params, unsigned inputs) const;
+
+			// the view stored as name under key, NULL if there is none
+			std::unique_ptr<MAPPED> load(std::string const& name, uint64_t key) const {
+				std::unique_ptr<MAPPED> r;
+				int fd = _dir.size() ? open((_dir + name).c_str(), O_RDONLY | O_CLOEXEC) : -1;
+				struct stat st;
+				if (fd < 0) {
+					PROFILE::count("view store", false);
+					return r;
+				} else if (fstat(fd, &st) || st.st_size < _header) { untested();
+					close(fd);
+					return r;
+				} else {
+				}
+
+				void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if (m == MAP_FAILED) { untested();
+					return r;
+				} else {
+					r.reset(new MAPPED(m, st.st_size, _header));
+				}
+
+				char const* h = static_cast<char const*>(m);
+				uint64_t k;
+				uint64_t n;
+				memcpy(&k, h + 8, 8);
+				memcpy(&n, h + 16, 8);
+				if (memcmp(h, "HCIVIEW1", 8) || k != key || n != uint64_t(st.st_size) - _header) {
+					// stale or broken
+					r.reset();
+				} else {
+				}
+				PROFILE::count("view store", bool(r));
+				return r;
+			}
+
+			// keep data as name under key. a new file replaces the old one
+			// in one step, readers see one or the other.
+			void save(std::string const& name, uint64_t key, STRING_VIEW data) const {
+				if (_dir.empty()) { untested();
+					return;
+				} else {
+				}
+				mkdirs(_dir);
+				std::string tmp = _dir + name + ".tmp" + std::to_string(getpid());
+				int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+				if (fd < 0) { untested();
+					return;
+				} else {
+				}
+
+				char h[_header];
+				uint64_t n = data.size();
+				memcpy(h, "HCIVIEW1", 8);
+				memcpy(h + 8, &key, 8);
+				memcpy(h + 16, &n, 8);
+				struct iovec v[2] = {
+					{ h, sizeof(h) },
+					{ const_cast<char*>(data.data()), data.size() }
+				};
+				bool ok = writev(fd, v, 2) == ssize_t(sizeof(h) + data.size());
+				if (close(fd) || !ok) { untested();
+					unlink(tmp.c_str());
+				} else if (rename(tmp.c_str(), (_dir + name).c_str())) { untested();
+					unlink(tmp.c_str());
+				} else {
+				}
+			}
+
+		private:
+			static uint64_t fnv(void const* p, size_t n, uint64_t h = 14695981039346656037ull) {
+				unsigned char const* c = static_cast<unsigned char const*>(p);
+				for (size_t i = 0; i < n; ++i) {
+					h = (h ^ c[i]) * 1099511628211ull;
+				}
+				return h;
+			}
+			static std::string hex(uint64_t v) {
+				char b[17];
+				snprintf(b, sizeof(b), "%016llx", static_cast<unsigned long long>(v));
+				return b;
+			}
+			static uint64_t mtime(std::string const& path, uint64_t h) {
+				struct stat st;
+				int64_t t[2] = { 0, 0 };
+				if (!stat(path.c_str(), &st)) {
+					t[0] = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+					t[1] = st.st_size;
+				} else {
+				}
+				return fnv(t, sizeof(t), h);
+			}
+			static void mkdirs(std::string const& d) {
+				for (size_t i = 1; i < d.size(); ++i) {
+					if (d[i] == '/') {
+						mkdir(d.substr(0, i).c_str(), 0777);
+					} else {
+					}
+				}
+			}
+
+		private:
+			REPO& _repo;
+			std::string _dir;
+	};
+
+	inline uint64_t VIEW_STORE::key(std::string const& params, unsigned inputs) const
+	{
+		uint64_t h = fnv(params.data(), params.size());
+		h = fnv(&inputs, sizeof(inputs), h);
+		git_repository* r = _repo._repo;
+		std::string g = _repo.path();
+
+		if (inputs & _head) {
+			git_oid id;
+			if (git_reference_name_to_id(&id, r, "HEAD")) {
+				// unborn
+				h = fnv("-", 1, h);
+			} else {
+				h = fnv(id.id, GIT_OID_RAWSZ, h);
+			}
+		} else {
+		}
+
+		if (inputs & _refs) {
+			git_reference_iterator* i;
+			git_reference* ref;
+			if (!git_reference_iterator_new(&i, r)) {
+				while (!git_reference_next(&ref, i)) {
+					char const* n = git_reference_name(ref);
+					h = fnv(n, strlen(n) + 1, h);
+					if (git_oid const* id = git_reference_target(ref)) {
+						h = fnv(id->id, GIT_OID_RAWSZ, h);
+					} else if (char const* t = git_reference_symbolic_target(ref)) { untested();
+						h = fnv(t, strlen(t) + 1, h);
+					} else { untested();
+					}
+					git_reference_free(ref);
+				}
+				git_reference_iterator_free(i);
+			} else { untested();
+			}
+		} else {
+		}
+
+		if (inputs & _config) {
+			h = mtime(g + "config", h);
+		} else {
+		}
+		if (inputs & _index) {
+			h = mtime(g + "index", h);
+		} else {
+		}
+		if (inputs & _objects) {
+			std::vector<int64_t> t = objects_stamp(g + "objects/");
+			h = fnv(t.data(), t.size() * sizeof(t[0]), h);
+		} else {
+		}
+		return h;
+	}
+
+	// the store is a list of target id, seconds, tagger and a 0. it is
+	// keyed on nothing but its name, the objects in it never change.
+	inline TAGS::INFOS& TAGS::infos() const
+	{
+		INFO_CACHE& c = info_cache();
+		auto r = c.repos.find(_repo.path());
+		if (r != c.repos.end()) {
+			return r->second;
+		} else {
+		}
+
+		INFOS& x = c.repos[_repo.path()];
+		VIEW_STORE s(_repo);
+		if (auto d = s.load("tag-info", s.key("tag-info", 0))) {
+			char const* p = d->data().begin();
+			char const* e = d->data().end();
+			while (e - p > GIT_OID_RAWSZ + 8) {
+				git_oid id;
+				int64_t seconds;
+				memcpy(id.id, p, GIT_OID_RAWSZ);
+				memcpy(&seconds, p + GIT_OID_RAWSZ, 8);
+				char const* n = p + GIT_OID_RAWSZ + 8;
+				char const* z = static_cast<char const*>(memchr(n, 0, e - n));
+				if (!z) { untested();
+					break;
+				} else {
+				}
+				x[OID(id)] = INFO(std::string(n, z), git_time_t(seconds));
+				p = z + 1;
+			}
+		} else {
+		}
+		return x;
+	}
+
+	inline TAGS::INFO TAGS::info(TAG const& t) const
+	{
+		INFO_CACHE& ic = info_cache();
+		{
+			std::lock_guard<std::mutex> l(ic.m);
+			INFOS const& x = infos();
+			auto c = x.find(t.target());
+			if (c != x.end()) {
+				PROFILE::count("tag info", true);
+				return c->second;
+			} else {
+				PROFILE::count("tag info", false);
+			}
+		}
+
+		INFO i;
+		git_tag* tag;
+		git_commit* c;
+		if (t.annotated() && !git_tag_lookup(&tag, _repo._repo, &t.target().get())) {
+			if (git_signature const* s = git_tag_tagger(tag)) {
+				i = INFO(s->name, s->when.time);
+			} else { untested();
+			}
+			git_tag_free(tag);
+		} else if (!git_commit_lookup(&c, _repo._repo, &t.peeled().get())) {
+			i = INFO("", git_commit_time(c));
+			git_commit_free(c);
+		} else { untested();
+			// a tree or blob
+		}
+
+		std::lock_guard<std::mutex> l(ic.m);
+		infos()[t.target()] = i;
+		_new_info = true;
+		return i;
+	}
+
+	inline TAGS::~TAGS()
+	{
+		if (!_new_info) {
+			return;
+		} else {
+		}
+
+		std::string d;
+		{
+			std::lock_guard<std::mutex> l(info_cache().m);
+			for (auto const& i : infos()) {
+				int64_t seconds = i.second.seconds();
+				d.append(reinterpret_cast<char const*>(i.first.get().id), GIT_OID_RAWSZ);
+				d.append(reinterpret_cast<char const*>(&seconds), 8);
+				d.append(i.second.tagger().c_str(), i.second.tagger().size() + 1);
+			}
+		}
+		VIEW_STORE s(_repo);
+		s.save("tag-info", s.key("tag-info", 0), STRING_VIEW(d.data(), d.size()));
 	}
 
 	//inline void REPO::checkout(COMMIT const& refname)
@@ -1,10 +1,17 @@
 #ifndef HCI_H
 #define HCI_H
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <map>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <string.h>
 #include <unistd.h>
 #include <termios.h>
+#include <sys/select.h>
 #include <stdio.h> // getchar
 #include <stdlib.h> // exit
 
@@ -44,6 +51,29 @@ class HCI_EOI : public HCI_EXCEPTION {
 		explicit HCI_EOI() : HCI_EXCEPTION("end of input") { }
 };
 
+/* -------------------------------------------------------------------------- */
+class HCI;
+
+// where to go after a key press. see HCI_APPLICATION::navigate
+class HCI_NAV {
+	public:
+		enum op_t {
+			_stay, // wait for the next key
+			_push, // show target, come back here when it is done
+			_pop,  // back to where we came from
+			_up,   // leave the menu tree altogether
+			_quit  // leave the program
+		};
+	public:
+		HCI_NAV(op_t o = _stay, HCI* t = NULL) : _op(o), _target(t) { }
+	public:
+		op_t op() const { return _op; }
+		HCI* target() const { return _target; }
+	private:
+		op_t _op;
+		HCI* _target;
+};
+
 /* -------------------------------------------------------------------------- */
 // human interaction base class
 class HCI {
@@ -63,6 +93,23 @@ class HCI {
 			return _name;
 		}
 
+	public: // navigation
+		// selected from a menu. by default, show this.
+		virtual HCI_NAV activate() {
+			return HCI_NAV(HCI_NAV::_push, this);
+		}
+		// a key was pressed while this is shown. by default, go back.
+		virtual HCI_NAV key(int) {
+			return HCI_NAV(HCI_NAV::_pop);
+		}
+		void draw() {
+			clear();
+			show();
+		}
+		int readkey() {
+			return waitkey();
+		}
+
 	protected: // I/O
 		static std::istream& in();
 		static std::ostream& out();
@@ -107,6 +154,41 @@ class HCI {
 			return c;
 		}
 
+		// getkey, but call event() whenever event_fd() becomes readable
+		// while waiting for the key.
+		int waitkey() {
+			int fd = event_fd();
+
+			while (fd >= 0 && isatty(fileno(stdin))) {
+				fd_set s;
+				FD_ZERO(&s);
+				FD_SET(STDIN_FILENO, &s);
+				FD_SET(fd, &s);
+
+				set_tty_attributes();
+				int n = select((fd > STDIN_FILENO ? fd : STDIN_FILENO) + 1, &s, NULL, NULL, NULL);
+				restore_tty_attributes();
+
+				if (n < 0 && errno == EINTR) { untested();
+				} else if (n < 0) { untested();
+					break;
+				} else if (FD_ISSET(STDIN_FILENO, &s)) {
+					break;
+				} else {
+					event();
+					fd = event_fd();
+				}
+			}
+
+			return getkey();
+		}
+
+	protected: // events
+		// signals a change worth redrawing for, -1 if none.
+		virtual int event_fd() { return -1; }
+		// event_fd() became readable.
+		virtual void event() { }
+
 		void beep() {
 			// this is system dependent. you may not hear it.
 			// use screen & turn on visible bell. then you can see it.
@@ -156,7 +238,18 @@ class HCI_ACTION : public HCI {
 		explicit HCI_ACTION(std::string const& s = "action")
 			: HCI(s) {}
 	public:
-		virtual void do_it()=0;
+		HCI_NAV activate() {
+			return do_it();
+		}
+		virtual HCI_NAV do_it()=0;
+	protected:
+		// let a message sink in, unless nobody is watching
+		void linger() const {
+			if (isatty(fileno(stdin))) {
+				sleep(1);
+			} else {
+			}
+		}
 };
 
 // quit program
@@ -164,10 +257,10 @@ class HCI_QUIT : public HCI_ACTION {
 	public:
 		HCI_QUIT() : HCI_ACTION("quit") {}
 	private:
-		void do_it() {
+		HCI_NAV do_it() {
 			out() << " goodbye\n";
-			sleep(1);
-			exit(0);
+			linger();
+			return HCI_NAV(HCI_NAV::_quit);
 		}
 };
 extern HCI_QUIT hci_quit;
@@ -177,8 +270,9 @@ class HCI_BEEP : public HCI_ACTION {
 	public:
 		HCI_BEEP() : HCI_ACTION("beep") {}
 	private:
-		void do_it() {
+		HCI_NAV do_it() {
 			beep();
+			return HCI_NAV();
 		}
 };
 extern HCI_BEEP hci_beep;
@@ -188,10 +282,10 @@ class HCI_LEAVE : public HCI_ACTION {
 	public:
 		HCI_LEAVE() : HCI_ACTION("no, quit") {}
 	private:
-		void do_it() {
+		HCI_NAV do_it() {
 			out() << "\n\nRepository not created, exiting program\n";
-			sleep(1);
-			exit(0);
+			linger();
+			return HCI_NAV(HCI_NAV::_quit);
 		}
 };
 extern HCI_LEAVE hci_leave;
@@ -204,23 +298,400 @@ class HCI_PAGE : public HCI {
 		{
 		}
 	public:
-		virtual void enter() {
-			clear();
-			show();
-			// set_status(std::string("showing ") + name() + ". Hit any key");
-			pause();
-			throw(HCI_LEAVE());
-		}
-		void pause() { untested();
-			getkey();
+		// any key leaves
+		HCI_NAV key(int) {
+			return HCI_NAV(HCI_NAV::_pop);
 		}
 	public:
 		void help() {
 		}
 };
 
+// a page longer than the screen, shown rows() lines at a time. space or
+// 'n' for the next screen, 'p' for the previous one, any other key leaves.
+class HCI_PAGER : public HCI_PAGE {
+	public:
+		explicit HCI_PAGER(std::string const& name="unnamed pager", size_t rows=20)
+			: HCI_PAGE(name), _rows(rows), _top(0), _more(false)
+		{
+		}
+	public:
+		// from the top again
+		HCI_NAV activate() {
+			_top = 0;
+			return HCI_PAGE::activate();
+		}
+		HCI_NAV key(int c) {
+			if (c == ' ' || c == 'n') {
+				if (_more) {
+					_top += _rows;
+					draw();
+				} else {
+				}
+				return HCI_NAV();
+			} else if (c == 'p') {
+				if (_top) {
+					_top -= std::min(_top, _rows);
+					draw();
+				} else {
+				}
+				return HCI_NAV();
+			} else {
+				return HCI_NAV(HCI_NAV::_pop);
+			}
+		}
+	protected:
+		// write lines [top, top + n), false if there are none after them
+		virtual bool lines(std::ostream& o, size_t top, size_t n) = 0;
+		size_t rows() const { return _rows; }
+		// the visible window, then what the keys do
+		void show() {
+			_more = lines(out(), _top, _rows);
+			out() << "\n";
+			if (_more) {
+				out() << "(space: next page) ";
+			} else {
+			}
+			if (_top) {
+				out() << "(p: previous page) ";
+			} else {
+			}
+			out() << "(any other key to leave)\n";
+		}
+	private:
+		size_t _rows;
+		size_t _top;
+		bool _more;
+};
+
 class HCI_APPLICATION;
 
+// fuzzy matching of a query against many strings.
+//
+// the candidates are kept in one arena, lower case, with an offset each
+// and a bit mask of the characters in it. a query matches when its
+// characters appear in order. matching is greedy
+// and incremental: each survivor remembers where its match ends, and one
+// more query character is one memchr from there, over the survivors of
+// the shorter query only. the score is built up along the way.
+//
+// the first character would have to look at all candidates. instead, add()
+// files each candidate under every character it contains, matched and
+// scored, and the first level of survivors is that list. candidates are
+// cut to 64k characters, so that a HIT fits in 8 bytes.
+class HCI_FUZZY {
+	public:
+		struct HIT {
+			uint32_t i;     // candidate
+			uint16_t end;   // after the last matched character
+			int16_t score;
+		};
+	public:
+		HCI_FUZZY() : _off(1, 0), _first(256), _c0(-1) {}
+	public:
+		void clear() {
+			_text.clear();
+			_off.assign(1, 0);
+			_mask.clear();
+			_first.assign(256, std::vector<HIT>());
+			_c0 = -1;
+			_level.clear();
+		}
+		void add(std::string const& s) {
+			uint64_t m = 0;
+			uint32_t i = uint32_t(size());
+			size_t b = _text.size();
+			size_t n = std::min(s.size(), size_t(0xffff));
+			bool seen[256] = {};
+			for (size_t k = 0; k < n; ++k) {
+				char c = char(tolower(static_cast<unsigned char>(s[k])));
+				unsigned char u = static_cast<unsigned char>(c);
+				_text.push_back(c);
+				m |= bit(c);
+				if (!seen[u]) {
+					seen[u] = true;
+					HIT h = { i, uint16_t(k + 1), int16_t(first_score(_text.data() + b, uint32_t(k))) };
+					_first[u].push_back(h);
+				} else {
+				}
+			}
+			_off.push_back(uint32_t(_text.size()));
+			_mask.push_back(m);
+			_c0 = -1;
+			_level.clear();
+		}
+		size_t size() const { return _off.size() - 1; }
+		size_t query_size() const { return _c0 < 0 ? 0 : 1 + _level.size(); }
+		// all candidates, or those matching the query
+		size_t matches() const { return _c0 < 0 ? size() : survivors().size(); }
+
+		// one more query character
+		void push(char c) {
+			c = char(tolower(static_cast<unsigned char>(c)));
+			if (_c0 < 0) {
+				_c0 = static_cast<unsigned char>(c);
+			} else {
+				filter(c);
+			}
+		}
+		// one query character less
+		void pop() {
+			if (_level.size()) {
+				_level.pop_back();
+			} else {
+				_c0 = -1;
+			}
+		}
+		// the k best matches, best first. candidate order without a query.
+		std::vector<HIT> top(size_t k) const {
+			std::vector<HIT> t;
+			if (_c0 < 0) {
+				for (uint32_t i = 0; i < size() && i < k; ++i) {
+					HIT h = { i, 0, 0 };
+					t.push_back(h);
+				}
+				return t;
+			} else {
+			}
+			auto better = [this](HIT const& a, HIT const& b) {
+				if (a.score != b.score) {
+					return a.score > b.score;
+				} else if (length(a.i) != length(b.i)) {
+					return length(a.i) < length(b.i);
+				} else {
+					return a.i < b.i;
+				}
+			};
+			// a heap of the k best so far, the worst of them on top
+			for (HIT const& h : survivors()) {
+				if (t.size() < k) {
+					t.push_back(h);
+					std::push_heap(t.begin(), t.end(), better);
+				} else if (k && better(h, t.front())) {
+					std::pop_heap(t.begin(), t.end(), better);
+					t.back() = h;
+					std::push_heap(t.begin(), t.end(), better);
+				} else {
+				}
+			}
+			std::sort_heap(t.begin(), t.end(), better);
+			return t;
+		}
+		uint32_t length(uint32_t i) const { return _off[i + 1] - _off[i]; }
+
+	private:
+		// with a query
+		std::vector<HIT> const& survivors() const {
+			return _level.size() ? _level.back() : _first[_c0];
+		}
+
+		// the survivors that match c after their end. chunks are written in
+		// place and closed up after, on a few threads if there are many.
+		void filter(char c) {
+			std::vector<HIT> const& in = survivors();
+			size_t m = in.size();
+			size_t const chunk = 1 << 16;
+			size_t n = (m + chunk - 1) / chunk;
+			std::vector<HIT> out(m);
+			std::vector<size_t> found(n, 0);
+			auto run = [&](size_t k) {
+				size_t e = std::min(m, (k + 1) * chunk);
+				HIT* o = out.data() + k * chunk;
+				for (size_t j = k * chunk; j < e; ++j) {
+					HIT h = in[j];
+					if (step(h, c)) {
+						*o++ = h;
+					} else {
+					}
+				}
+				found[k] = o - (out.data() + k * chunk);
+			};
+
+			unsigned w = std::max(1u, std::min(unsigned(n), std::thread::hardware_concurrency()));
+			std::vector<std::thread> t;
+			for (unsigned i = 1; i < w; ++i) {
+				t.emplace_back([&, i] {
+					for (size_t k = i; k < n; k += w) {
+						run(k);
+					}
+				});
+			}
+			for (size_t k = 0; k < n; k += w) {
+				run(k);
+			}
+			for (auto& i : t) {
+				i.join();
+			}
+
+			size_t have = n ? found[0] : 0;
+			for (size_t k = 1; k < n; ++k) {
+				std::copy(out.begin() + k * chunk, out.begin() + k * chunk + found[k], out.begin() + have);
+				have += found[k];
+			}
+			out.resize(have);
+			_level.push_back(std::move(out));
+		}
+
+		// the score of a first match at at
+		static int32_t first_score(char const* b, uint32_t at) {
+			return 16 - int32_t(std::min<uint32_t>(at, 8)) + (word_start(b, at) ? 6 : 0);
+		}
+		static bool word_start(char const* b, uint32_t at) {
+			return !at || (b[at - 1] && strchr("/-_. :", b[at - 1]));
+		}
+
+		// match c in candidate h.i after h.end. consecutive characters and
+		// word starts score, gaps cost.
+		bool step(HIT& h, char c) const {
+			if (!(_mask[h.i] & bit(c))) {
+				// not in there at all, most are not
+				return false;
+			} else {
+			}
+			char const* b = _text.data() + _off[h.i];
+			char const* e = _text.data() + _off[h.i + 1];
+			char const* p = static_cast<char const*>(memchr(b + h.end, c, e - b - h.end));
+			if (!p) {
+				return false;
+			} else {
+			}
+			uint32_t at = uint32_t(p - b);
+			int32_t s = h.score + 16;
+			if (at == h.end) {
+				s += 8;
+			} else {
+				s -= int32_t(std::min<uint32_t>(at - h.end, 8));
+			}
+			if (word_start(b, at)) {
+				s += 6;
+			} else {
+			}
+			h.score = int16_t(s);
+			h.end = uint16_t(at + 1);
+			return true;
+		}
+
+		static uint64_t bit(char c) {
+			return uint64_t(1) << (static_cast<unsigned char>(c) % 64);
+		}
+
+	private:
+		std::vector<char> _text;
+		std::vector<uint32_t> _off;
+		std::vector<uint64_t> _mask;
+		std::vector<std::vector<HIT> > _first; // by character, matched and scored
+		int _c0; // first query character, -1 for none
+		std::vector<std::vector<HIT> > _level; // survivors after each further query character
+};
+
+// a fuzzy finder over candidates of a few kinds. typing narrows the list,
+// backspace widens it, enter picks the best match, escape leaves.
+class HCI_FINDER : public HCI_PAGE {
+	public:
+		explicit HCI_FINDER(std::string const& name="finder", size_t rows=15)
+			: HCI_PAGE(name), _rows(rows), _us(0) {}
+	public:
+		// a fresh query, candidates reloaded if needed
+		HCI_NAV activate() {
+			if (stale()) {
+				_fuzzy.clear();
+				_kind.clear();
+				_orig.clear();
+				_orig_off.clear();
+				load();
+			} else {
+			}
+			while (_fuzzy.query_size()) {
+				_fuzzy.pop();
+			}
+			_query.clear();
+			return HCI_PAGE::activate();
+		}
+		HCI_NAV key(int c) {
+			auto t0 = std::chrono::steady_clock::now();
+			if (c == 0x1b) {
+				return HCI_NAV(HCI_NAV::_pop);
+			} else if (c == '\n' || c == '\r') {
+				auto t = _fuzzy.top(1);
+				if (t.size()) {
+					return chosen(_kind[t[0].i], text(t[0].i));
+				} else {
+					return HCI_NAV();
+				}
+			} else if (c == '\b' || c == 127) {
+				if (_query.size()) {
+					_query.resize(_query.size() - 1);
+					_fuzzy.pop();
+				} else {
+				}
+			} else if (isprint(c)) {
+				_query += char(c);
+				_fuzzy.push(char(c));
+			} else {
+				return HCI_NAV();
+			}
+			std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+			_us = unsigned(d.count() * 1e6);
+			draw();
+			return HCI_NAV();
+		}
+		void show() {
+			out() << "Find: " << _query << "\n\n";
+			for (auto const& h : _fuzzy.top(_rows)) {
+				out() << " " << _names[_kind[h.i]] << "\t" << text(h.i) << "\n";
+			}
+			out() << "\n" << _fuzzy.matches() << " of " << _fuzzy.size();
+			if (_query.size()) {
+				out() << " in " << _us << "us";
+			} else {
+			}
+			out() << " (enter to pick, escape to leave)\n";
+		}
+
+	protected:
+		// fill in with add()
+		virtual void load() = 0;
+		// true if load() would find something else
+		virtual bool stale() { return true; }
+		// enter was pressed on this candidate
+		virtual HCI_NAV chosen(unsigned kind, std::string const& text) = 0;
+
+		// a kind of candidate, "branch" etc.
+		unsigned kind(std::string const& name) {
+			for (unsigned i = 0; i < _names.size(); ++i) {
+				if (_names[i] == name) {
+					return i;
+				} else {
+				}
+			}
+			_names.push_back(name);
+			return unsigned(_names.size() - 1);
+		}
+		void add(unsigned kind, std::string const& text) {
+			_fuzzy.add(text);
+			_kind.push_back(kind);
+			_orig.insert(_orig.end(), text.begin(), text.end());
+			_orig_off.push_back(_orig.size());
+		}
+		std::string const& kind_name(unsigned k) const { return _names[k]; }
+
+	private:
+		std::string text(uint32_t i) const {
+			size_t b = i ? _orig_off[i - 1] : 0;
+			return std::string(_orig.data() + b, _orig_off[i] - b);
+		}
+
+	private:
+		size_t _rows;
+		unsigned _us; // last keystroke
+		std::string _query;
+		HCI_FUZZY _fuzzy;
+		std::vector<std::string> _names;
+		std::vector<unsigned char> _kind;
+		std::vector<char> _orig; // as given, for display
+		std::vector<size_t> _orig_off; // end of each
+};
+
 // display choices to a user and query
 class HCI_MENU : public HCI {
 	private: // internal types
@@ -236,13 +707,15 @@ class HCI_MENU : public HCI {
 			std::string _label;
 			HCI* _action;
 		};
-		typedef std::map<char, menu_opt_t> map_type;
+		// one slot per key, a key press is a single lookup.
+		enum { _keys = 256 };
 	public:
 		explicit HCI_MENU(HCI_APPLICATION& ctx, std::string name = "menu") :
 			HCI(name), _ctx(ctx) {}
 	public:
 		void add(char c, HCI* h, std::string label = "") {
-			if (_m.find(c) != _m.end()) {
+			menu_opt_t& o = _m[static_cast<unsigned char>(c)];
+			if (o.action()) {
 				std::cerr << "WARNING: overwriting " << c << " in " << name() << "\n";
 			}
 
@@ -251,39 +724,23 @@ class HCI_MENU : public HCI {
 			} else {
 			}
 
-			menu_opt_t o(label, h);
-			// emplace?
-			_m[c] = o;
+			o = menu_opt_t(label, h);
 		}
 
 		void help() {}
 
 		void show() {
-			for(map_type::const_iterator i = _m.begin(); i != _m.end(); ++i) {
-				if (isalnum(i->first)) {
-					show_menu_option(i->first, i->second.label());
+			for (int i = 0; i < _keys; ++i) {
+				if (!_m[i].action()) {
+				} else if (isalnum(i)) {
+					show_menu_option(char(i), _m[i].label());
 				} else {
 					// escape, backspace etc..
 				}
 			}
 		}
 
-		void enter();
-		bool query();
-	private:
-		void exec(HCI* h) {
-			// See Stroustrup 15.4.5
-			if (HCI_ACTION* a = dynamic_cast<HCI_ACTION*>(h)) { untested();
-				a->do_it();
-			} else if (HCI_MENU* m = dynamic_cast<HCI_MENU*>(h)) { untested();
-				// submenu?
-				m->enter();
-			} else if (HCI_PAGE* m = dynamic_cast<HCI_PAGE*>(h)) { untested();
-				m->enter(); // display?
-			} else {
-				unreachable();
-			}
-		}
+		HCI_NAV key(int c);
 	protected:
 		virtual void show_menu_option(char c, std::string const& s) {
 			out() << " " << c << " " << s << "\n";
@@ -291,20 +748,21 @@ class HCI_MENU : public HCI {
 		HCI_APPLICATION& ctx() { return _ctx; }
 	private:
 		HCI_APPLICATION& _ctx;
-		map_type _m;
+		menu_opt_t _m[_keys];
 };
 
+// back to the previous menu
 class HCI_UP : public HCI_ACTION {
-	void do_it() { untested();
-		throw *this;
+	HCI_NAV do_it() {
+		return HCI_NAV(HCI_NAV::_pop);
 	}
 };
 extern HCI_UP hci_up;
 
 // can be used to signal escape button
 class HCI_ESCAPE : public HCI_ACTION {
-	void do_it() {
-		throw *this;
+	HCI_NAV do_it() {
+		return HCI_NAV(HCI_NAV::_up);
 	}
 };
 extern HCI_ESCAPE hci_esc;
@@ -314,29 +772,44 @@ class HCI_APPLICATION : public HCI_PAGE {
 	public:
 		HCI_APPLICATION(std::string const& name = "unnamed application",
 						int argc = 0, char const *argv[] = NULL)
-			: HCI_PAGE(name), _status("")
+			: HCI_PAGE(name), _status(""), _timing(false), _finder(NULL)
 		{
 		}
 	public: // protect?
 		void set_status(std::string const& s, size_t tail = 0);
+		// record the time from key press to completed screen
+		void set_timing(bool t) { _timing = t; }
+		// shown by '/' in any menu that doesn't use it
+		void set_finder(HCI* f) { _finder = f; }
+		HCI* finder() const { return _finder; }
+
+	protected:
+		// show root and whatever is chosen from there, until it is left.
+		// false if the user quit.
+		bool navigate(HCI& root);
 
 	private:
 		std::string _status;
+		bool _timing;
+		std::vector<double> _latency; // seconds
+		HCI* _finder;
 	public:
 		int exec() {
 			try {
 				show();
-				return 0;
 			}
 			catch (HCI_EOI const&) {
 				std::cerr << "broken pipe\n";
-				return 0;
 			}
-			catch (HCI_ESCAPE const&) {
-				out() << "unhandled escape event\n";
-				return 1;
+
+			if (_timing) {
+				report_latency();
+			} else {
 			}
+			return 0;
 		}
+	private:
+		void report_latency() const;
 	private: // not used right now.
 		int _argc;
 		char const** _argv;
@@ -360,47 +833,87 @@ inline void HCI_APPLICATION::set_status(std::string const& s, size_t tail /*= 0*
 	_status = s;
 }
 /* -------------------------------------------------------------------------- */
-inline void HCI_MENU::enter()
+// a stack of screens. the top one gets the keys and says where to go next.
+inline bool HCI_APPLICATION::navigate(HCI& root)
 {
-	while (true) {
-		clear();
-		show();
+	std::vector<HCI*> stack(1, &root);
+	root.draw();
+
+	while (stack.size()) {
+		int c = stack.back()->readkey();
+		auto t0 = std::chrono::steady_clock::now();
+		HCI_NAV n = stack.back()->key(c);
+
+		switch (n.op()) {
+			case HCI_NAV::_stay:
+				break;
+			case HCI_NAV::_push:
+				stack.push_back(n.target());
+				break;
+			case HCI_NAV::_pop:
+				stack.pop_back();
+				break;
+			case HCI_NAV::_up:
+				stack.clear();
+				break;
+			case HCI_NAV::_quit:
+				return false;
+		}
 
-		try {
-			query();
-			break;
+		if (n.op() != HCI_NAV::_stay && stack.size()) {
+			stack.back()->draw();
+		} else {
 		}
-		catch (HCI_LEAVE const&) {
-			continue;
+		out().flush();
+
+		if (_timing) {
+			std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+			_latency.push_back(d.count());
+		} else {
 		}
 	}
+
+	return true;
 }
+/* -------------------------------------------------------------------------- */
+inline void HCI_APPLICATION::report_latency() const
+{
+	std::vector<double> l(_latency);
+	if (l.empty()) { untested();
+		return;
+	} else {
+	}
+	std::sort(l.begin(), l.end());
 
+	double sum = 0;
+	for (double x : l) {
+		sum += x;
+	}
+	std::cerr << "keys " << l.size()
+		<< " mean " << 1e6 * sum / l.size() << "us"
+		<< " p50 " << 1e6 * l[l.size() / 2] << "us"
+		<< " p99 " << 1e6 * l[l.size() * 99 / 100] << "us"
+		<< " max " << 1e6 * l.back() << "us\n";
+}
 /* -------------------------------------------------------------------------- */
-// wait for user input, process.
-inline bool HCI_MENU::query() {
-	bool _insist = true; // for now.
-	while (_insist) {
-		char i;
-		i = getkey();
-		map_type::iterator f(_m.find(i));
-			// TODO: handle ESC
-
-		if (f != _m.end()) {
-			HCI* h = f->second.action();
-			exec(h);
-		} else if (i == 0x1b) {
-			_ctx.set_status("Esc is not assigned");
-		} else if (!isalnum(i)) {
-			_ctx.set_status("can't do that");
-		} else {
-			_ctx.set_status("'" + std::string(1, i) + "' not assigned" );
-			// beep?!
-		}
+// a key press, look it up.
+inline HCI_NAV HCI_MENU::key(int c) {
+	unsigned char i = static_cast<unsigned char>(c);
+
+	if (HCI* h = _m[i].action()) {
+		return h->activate();
+	} else if (i == '/' && _ctx.finder()) {
+		return _ctx.finder()->activate();
+	} else if (i == 0x1b) {
+		_ctx.set_status("Esc is not assigned");
+	} else if (!isalnum(i)) {
+		_ctx.set_status("can't do that");
+	} else {
+		_ctx.set_status("'" + std::string(1, i) + "' not assigned" );
+		// beep?!
 	}
 
-	incomplete();
-	return false;
+	return HCI_NAV();
 }
 /* -------------------------------------------------------------------------- */
 #endif
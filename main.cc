@@ -1,4 +1,16 @@
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "hci0.h"
 #include "gitpp5.h"
 
@@ -7,16 +19,114 @@ using namespace GITPP;
 
 bool exists = false;
 
+// change notification, once there is a repository
+unique_ptr<NOTIFY> notify;
+
+// the text of a view. with notify, it is only rebuilt after a change to one
+// of its inputs (NOTIFY::_head etc.), otherwise every time.
+//
+// a view with a store name is also kept in the repository (VIEW_STORE),
+// keyed on the state of its inputs and stored inputs (VIEW_STORE::_objects
+// etc.), and read from there when that state is unchanged, as on the next
+// run. notify doesn't see the object store, views depending on it are
+// looked up every time.
+class VIEW_CACHE {
+	public:
+		explicit VIEW_CACHE(unsigned inputs, string const& store = "", unsigned stored = 0)
+			: _inputs(inputs), _store(store), _stored(stored | inputs),
+			_valid(false), _subscribed(false) {}
+	public:
+		template<class F>
+		STRING_VIEW get(F render, string const& params = "") {
+			if (!notify) {
+				_valid = false;
+			} else if (_subscribed) {
+				notify->poll();
+			} else {
+				notify->subscribe(_inputs, [this](unsigned) { _valid = false; });
+				_subscribed = true;
+			}
+
+			if (notify) {
+				PROFILE::count("view cache", _valid);
+			} else {
+			}
+
+			if (_valid) {
+			} else if (_store.empty()) {
+				build(render);
+			} else {
+				REPO r;
+				VIEW_STORE s(r);
+				uint64_t k = s.key(params, _stored);
+				_mapped = s.load(_store, k);
+				if (!_mapped) {
+					build(render);
+					s.save(_store, k, STRING_VIEW(_text.data(), _text.size()));
+				} else {
+				}
+			}
+			_valid = _subscribed && !(_stored & VIEW_STORE::_objects);
+
+			if (_mapped) {
+				return _mapped->data();
+			} else {
+				return STRING_VIEW(_text.data(), _text.size());
+			}
+		}
+		// true if get() would rebuild
+		bool stale() {
+			if (notify) {
+				notify->poll();
+			} else {
+			}
+			return !_valid;
+		}
+		int fd() const {
+			return notify ? notify->fd() : -1;
+		}
+	private:
+		template<class F>
+		void build(F render) {
+			ostringstream o;
+			render(o);
+			_text = o.str();
+			_mapped.reset();
+		}
+	private:
+		unsigned _inputs;
+		string _store;
+		unsigned _stored;
+		bool _valid;
+		bool _subscribed;
+		string _text;
+		unique_ptr<VIEW_STORE::MAPPED> _mapped;
+};
+
+// true if a boolean option is set in the repository config
+static bool config_flag(REPO& r, string const& name)
+{
+	auto c = r.config();
+	try {
+		string v = c[name].value();
+		return v == "true" || v == "yes" || v == "on" || v == "1";
+	}
+	catch (EXCEPTION_CANT_FIND const&) {
+		return false;
+	}
+}
+
 // creates a new Git repository
 class HCI_CREATE : public HCI_ACTION {
 	public:
 		HCI_CREATE() : HCI_ACTION("yes") {}
 	private:
-		void do_it() {
+		HCI_NAV do_it() {
 			out() << "Creating repository\n";
 			REPO r(REPO::_create);
 			out() << "Repository created\n\n";
 			out() << "Press 'escape' to go to the main menu\n";
+			return HCI_NAV();
 		}
 };
 HCI_CREATE hci_create;
@@ -26,7 +136,7 @@ class MAKE_VARIABLE : public HCI_ACTION {
 	public:
 		MAKE_VARIABLE() : HCI_ACTION("create new variable") {}
 	private:
-		void do_it() {
+		HCI_NAV do_it() {
 			string input;
 
 			out() << "Input the value you would like the variable to have and press enter";
@@ -42,218 +152,1967 @@ class MAKE_VARIABLE : public HCI_ACTION {
 
 			out() << "\n\nVariable added\n\n";
 			out() << "(Press 'b' to go to the main menu)\n";
+			return HCI_NAV();
 		}
 };
 MAKE_VARIABLE make_variable;
 
+// read ahead before a long walk, if hci.prefetch is set. all of each pack
+// if all is set, otherwise the start.
+static PREFETCH* prefetch(REPO const& r, PROFILE const& p, bool all = false)
+{
+	int64_t n = p.get("hci.prefetch", 0);
+	return n > 0 ? new PREFETCH(r, all ? 0 : n) : NULL;
+}
+
 // list config page
 class LISTCONFIG_PAGE : public HCI_PAGE {
-		using HCI_PAGE::HCI_PAGE;
+	public:
+		LISTCONFIG_PAGE(string const& name, PROFILE const& p)
+			: HCI_PAGE(name), _profile(p),
+			_view(NOTIFY::_head | NOTIFY::_refs | NOTIFY::_config, "config") {}
 	public:
 		void show() {
 			out() << "-------------------------\n";
 			out() << "List Config\n\n";
+			out() << _view.get([this](ostream& o) {
+				REPO r;
+				unique_ptr<PREFETCH> pf(prefetch(r, _profile));
+				auto c = r.config();
 
-			REPO r;
-			auto c = r.config();
-
-			CONFIG::ITEM N = c["user.name"];
+				CONFIG::ITEM N = c["user.name"];
 
-			out() << "Hello " << N.value() << "\n\n";
+				o << "Hello " << N.value() << "\n\n";
 
-			out() << "Your commits\n";
+				o << "Your commits\n";
 
-			for (auto i : r.commits()) {
-				out() << i << " " << i.signature().name() << "\n";
-			}
+				for (auto i : r.commits()) {
+					o << i << " " << i.signature().name() << "\n";
+				}
 
-			out() << "\n";
-			out() << "These are your variables\n";
+				o << "\n";
+				o << "These are your variables\n";
 
-			for (auto i : r.config()) {
-				out() << i << "\n";
+				for (auto i : r.config()) {
+					o << i << "\n";
+				}
+			});
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
+	private:
+		// redraw when another process changes the repository
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				clear();
+				show();
+			} else {
 			}
+		}
+	private:
+		PROFILE const& _profile;
+		VIEW_CACHE _view;
+};
 
-			out() << "\nPress any key to leave\n";
+// a file at a commit, a screen at a time
+class BLOB_PAGE : public HCI_PAGER {
+	public:
+		explicit BLOB_PAGE(string const& name) : HCI_PAGER(name) {}
+	public:
+		void open(string const& rev, string const& path) {
+			_blob.reset();
+			_title = path + " at " + rev;
+			_repo.reset(new REPO);
+			_blob.reset(new BLOB_READER(*_repo, _repo->commit_id(rev), path));
+		}
+		HCI_NAV key(int c) {
+			HCI_NAV n = HCI_PAGER::key(c);
+			if (n.op() == HCI_NAV::_pop) {
+				_blob.reset();
+			} else {
+			}
+			return n;
+		}
+		void show() {
+			out() << "-------------------------\n";
+			out() << _title << ", " << _blob->size() << " bytes\n\n";
+			HCI_PAGER::show();
 			out() << "-------------------------\n";
 		}
+	private:
+		bool lines(ostream& o, size_t top, size_t n) {
+			vector<string> l;
+			bool more = _blob->lines(top + 1, n, l);
+			for (size_t i = 0; i < l.size(); ++i) {
+				o << setw(6) << top + i + 1 << "  " << l[i] << "\n";
+			}
+			return more;
+		}
+	private:
+		string _title;
+		unique_ptr<REPO> _repo;
+		unique_ptr<BLOB_READER> _blob;
 };
 
 // list commits page
 class LISTCOMMIT_PAGE : public HCI_PAGE {
-		using HCI_PAGE::HCI_PAGE;
+	public:
+		LISTCOMMIT_PAGE(string const& name, PROFILE const& p)
+			// the abbreviations depend on all objects
+			: HCI_PAGE(name), _profile(p),
+			_view(NOTIFY::_head | NOTIFY::_refs, "log", VIEW_STORE::_objects),
+			_blob("file") {}
 	public:
 		void show() {
 			out() << "-------------------------\n";
 			out() << "List Commits\n\n";
-			out() << "This is the list commits page\n\n";
-			out() << "Press any key to leave\n";
+			out() << _view.get([this](ostream& o) {
+				REPO r;
+				unique_ptr<PREFETCH> pf(prefetch(r, _profile));
+				auto ix = r.oid_index();
+				for (auto i : r.commits()) {
+					o << ix->short_id(i.oid()) << " " << i.author_view() << " " << i.time() << "\n";
+					o << "    " << i.message_view().line() << "\n";
+				}
+			});
+			out() << "\nPress 'f' to view a file, any other key to leave\n";
 			out() << "-------------------------\n";
 		}
-};
+		HCI_NAV key(int c) {
+			if (c != 'f') {
+				return HCI_PAGE::key(c);
+			} else {
+			}
 
-// menu to create a new repository
-class NOREPO_MENU : public HCI_MENU {
-	public:
-		explicit NOREPO_MENU(HCI_APPLICATION& ctx)
-			: HCI_MENU(ctx, "norepo") {
-			add(0x1b, &hci_esc);
-			add('y', &hci_create);
-			add('n', &hci_leave);
+			string rev;
+			string path;
+			out() << "Commit (empty for HEAD): ";
+			getstring(rev);
+			out() << "\nFile: ";
+			getstring(path);
+			out() << "\n";
+			try {
+				_blob.open(rev.size() ? rev : "HEAD", path);
+			}
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+				return HCI_NAV();
+			}
+			return _blob.activate();
+		}
+	private:
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				clear();
+				show();
+			} else {
+			}
 		}
+	private:
+		PROFILE const& _profile;
+		VIEW_CACHE _view;
+		BLOB_PAGE _blob;
+};
 
+// list branches page
+class BRANCHES_PAGE : public HCI_PAGE {
+	public:
+		explicit BRANCHES_PAGE(string const& name)
+			: HCI_PAGE(name), _view(NOTIFY::_head | NOTIFY::_refs) {}
 	public:
 		void show() {
 			out() << "-------------------------\n";
-			out() << "No repository found\n";
-			out() << "-------------------------\n\n";
-			HCI_MENU::show();
-			out() << "\n";
-		}
-		void enter() {
-			while (true) {
-				try {
-					HCI_MENU::enter();
-					break;
-				}
-				catch ( HCI_UP const&) {
-					continue;
+			out() << "Branches\n\n";
+			out() << _view.get([](ostream& o) {
+				REPO r;
+				for (auto b : r.branches()) {
+					o << (b.is_head() ? "* " : "  ") << b << "\n";
 				}
+			});
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
+	private:
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				clear();
+				show();
+			} else {
 			}
 		}
 	private:
+		VIEW_CACHE _view;
 };
 
-// configure repository menu
-class EDIT_MENU : public HCI_MENU {
+// repository health page, object store statistics
+class HEALTH_PAGE : public HCI_PAGE {
 	public:
-		explicit EDIT_MENU(HCI_APPLICATION& ctx)
-			: HCI_MENU(ctx, "configure repository") {
-			add(0x1b, &hci_esc);
-			add('a', &make_variable);
-			add('b', &hci_up);
+		HEALTH_PAGE(string const& name, PROFILE const& p)
+			: HCI_PAGE(name), _profile(p), _view(0, "health", VIEW_STORE::_objects) {}
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Repository Health\n\n";
+
+			out() << _view.get([this](ostream& o) {
+				REPO r;
+				unique_ptr<PREFETCH> pf(prefetch(r, _profile, true));
+				STATS s = r.stats();
+				pf.reset();
+
+				o << "loose objects:  " << s.loose_count() << "\n";
+				o << "loose size:     " << s.loose_size() / 1024 << " KiB\n";
+				o << "packs:          " << s.packs().size() << "\n";
+				o << "pack size:      " << s.pack_size() / 1024 << " KiB\n\n";
+
+				o << "commits:        " << s.count(GIT_OBJECT_COMMIT) << "\n";
+				o << "trees:          " << s.count(GIT_OBJECT_TREE) << "\n";
+				o << "blobs:          " << s.count(GIT_OBJECT_BLOB) << "\n";
+				o << "tags:           " << s.count(GIT_OBJECT_TAG) << "\n\n";
+
+				o << "Largest packs\n";
+				for (auto const& p : s.largest(5)) {
+					o << p.size() / 1024 << " KiB " << p.name() << "\n";
+				}
+			});
+
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
 		}
+	private:
+		PROFILE const& _profile;
+		VIEW_CACHE _view;
+};
 
+// working tree status page. with hci.statuswatch set, the status is kept
+// between visits and only paths that changed are looked at again.
+class STATUS_PAGE : public HCI_PAGE {
+		using HCI_PAGE::HCI_PAGE;
 	public:
 		void show() {
 			out() << "-------------------------\n";
-			out() << "Configure Repository\n";
-			out() << "-------------------------\n\n";
-			out() << "Your Git repository in <CWD>\n\n";
+			out() << "Working Tree Status\n\n";
 
-			REPO r;
-			int count = 1;
+			if (_status) {
+				_status->refresh();
+			} else {
+				_repo.reset(new REPO);
+				_status.reset(new STATUS(*_repo, config_flag(*_repo, "hci.statuswatch")));
+			}
 
-			for (auto i : r.config()) {
-				out() << to_string(count) << ". " << i << "\n";
-				count += 1;
+			int staged = 0;
+			int modified = 0;
+			int untracked = 0;
+			for (auto const& e : _status->entries()) {
+				out() << e << "\n";
+				staged += e.staged();
+				modified += e.modified();
+				untracked += e.untracked();
 			}
 
-			out() << "\nWould you like to create a new configuration variable?\n";
-			out() << "(Press 'a' to create one and 'b' to go back to the previous menu";
-			out() << "\n\n";
-			HCI_MENU::show();
+			out() << "\n" << staged << " staged, " << modified << " modified, "
+				<< untracked << " untracked\n";
+			if (!_status->watching()) {
+				_status.reset();
+				_repo.reset();
+			} else {
+			}
+
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
+	private:
+		unique_ptr<REPO> _repo;
+		unique_ptr<STATUS> _status;
+};
+
+// diagnostics page, libgit2 tuning and cache statistics
+class DIAGNOSTICS_PAGE : public HCI_PAGE {
+	public:
+		DIAGNOSTICS_PAGE(string const& name, PROFILE const& p)
+			: HCI_PAGE(name), _profile(p) {}
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Diagnostics\n\n";
+			_profile.print(out());
 			out() << "\n";
+			PROFILE::report(out());
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
 		}
+	private:
+		PROFILE const& _profile;
+};
 
-		void enter() {
-			while (true) {
-				try {
-					HCI_MENU::enter();
-					break;
-				}
-				catch ( HCI_UP const&) {
-					continue;
+// list tags page
+class TAGS_PAGE : public HCI_PAGE {
+	public:
+		explicit TAGS_PAGE(string const& name)
+			: HCI_PAGE(name), _view(NOTIFY::_refs, "tags") {}
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Tags\n\n";
+			out() << _view.get([](ostream& o) {
+				REPO r;
+				auto ix = r.oid_index();
+				auto tags = r.tags();
+				for (auto const& t : tags) {
+					auto i = tags.info(t);
+					time_t s = i.seconds();
+					char date[16] = "";
+					strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&s));
+					o << ix->short_id(t.peeled()) << " " << date << " " << t;
+					if (i.tagger().size()) {
+						o << " (" << i.tagger() << ")";
+					} else {
+					}
+					o << "\n";
 				}
+				o << "\n" << tags.size() << " tags\n";
+			});
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
+	private:
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				clear();
+				show();
+			} else {
 			}
 		}
 	private:
-		MAKE_VARIABLE make_variable;
+		VIEW_CACHE _view;
 };
 
-// main menu
-class ISREPO_MENU : public HCI_MENU {
+// which tags contain a commit
+class TAG_CONTAINS : public HCI_ACTION {
+	public:
+		TAG_CONTAINS() : HCI_ACTION("tags containing a commit") {}
+	private:
+		HCI_NAV do_it() {
+			string rev;
+			string pattern;
+
+			out() << "Commit: ";
+			getstring(rev);
+			out() << "\nTag pattern (empty for all): ";
+			getstring(pattern);
+			out() << "\n\n";
+
+			REPO r;
+			try {
+				auto tags = r.tags();
+				auto found = tags.containing(r.commit_id(rev), pattern.size() ? pattern : "*");
+				for (auto const& t : found) {
+					out() << t << "\n";
+				}
+				out() << "\n" << found.size() << " of " << tags.size() << " tags\n";
+			}
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+			}
+			out() << "\n(Press 'b' to go back)\n";
+			return HCI_NAV();
+		}
+};
+
+// tags menu
+class TAGS_MENU : public HCI_MENU {
 	public:
-		explicit ISREPO_MENU(HCI_APPLICATION& ctx)
-			: HCI_MENU(ctx, "isrepo"), _list_config("list config"),
-		_edit_menu(ctx), _list_commit("list commits") {
+		explicit TAGS_MENU(HCI_APPLICATION& ctx)
+			: HCI_MENU(ctx, "tags"), _list("list tags") {
 			add(0x1b, &hci_esc);
-			add('c', &_list_config);
-			add('e', &_edit_menu);
-			add('l', &_list_commit);
-			add('q', &hci_quit);
+			add('b', &hci_up);
+			add('c', &_contains);
+			add('l', &_list);
 		}
 
 	public:
 		void show() {
 			out() << "-------------------------\n";
-			out() << "Your Git repository\n";
+			out() << "Tags\n";
 			out() << "-------------------------\n\n";
 			HCI_MENU::show();
 			out() << "\n";
 		}
+	private:
+		TAGS_PAGE _list;
+		TAG_CONTAINS _contains;
+};
 
-		void enter() {
-			while (true) {
-				try {
-					HCI_MENU::enter();
-					break;
-				}
-				catch ( HCI_UP const&) {
-					continue;
+// reflog page. the log stays mapped while the page is shown, with an
+// iterator kept at the start of each screen seen so far.
+class REFLOG_PAGE : public HCI_PAGER {
+	public:
+		REFLOG_PAGE(string const& name, string const& ref)
+			: HCI_PAGER(name), _ref(ref) {}
+	public:
+		void set_ref(string const& ref) {
+			_ref = ref;
+		}
+		HCI_NAV activate() {
+			_marks.clear();
+			_log.reset();
+			_repo.reset(new REPO);
+			_log.reset(new REFLOG(*_repo, _ref));
+			_marks.push_back(_log->begin());
+			return HCI_PAGER::activate();
+		}
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Reflog of " << _ref << "\n\n";
+			HCI_PAGER::show();
+			out() << "-------------------------\n";
+		}
+	private:
+		bool lines(ostream& o, size_t top, size_t n) {
+			auto ix = _repo->oid_index();
+			size_t k = top / rows();
+			while (_marks.size() <= k) {
+				REFLOG::iterator i = _marks.back();
+				for (size_t j = 0; j < rows() && i != _log->end(); ++j) {
+					++i;
 				}
+				_marks.push_back(i);
+			}
+
+			REFLOG::iterator i = _marks[k];
+			for (size_t j = top % rows(); j && i != _log->end(); --j) { untested();
+				++i;
+			}
+			if (i == _log->end() && !top) {
+				o << "no entries\n";
+			} else {
 			}
+			for (; n && i != _log->end(); --n, ++i) {
+				REFLOG::ENTRY e = *i;
+				time_t s = e.seconds();
+				char date[24] = "";
+				strftime(date, sizeof(date), "%Y-%m-%d %H:%M", gmtime(&s));
+				o << ix->short_id(e.new_id()) << " " << date << " " << e.message() << "\n";
+			}
+			return i != _log->end();
 		}
 	private:
-		LISTCONFIG_PAGE _list_config;
-		EDIT_MENU _edit_menu;
-		LISTCOMMIT_PAGE _list_commit;
+		string _ref;
+		unique_ptr<REPO> _repo;
+		unique_ptr<REFLOG> _log;
+		vector<REFLOG::iterator> _marks;
 };
 
-class APPLICATION : public HCI_APPLICATION {
+// asks for a branch, then shows its reflog
+class BRANCH_REFLOG : public HCI_ACTION {
+	public:
+		BRANCH_REFLOG() : HCI_ACTION("reflog of a branch"), _page("branch reflog", "") {}
+	private:
+		HCI_NAV do_it() {
+			string name;
+			out() << "Branch: ";
+			getstring(name);
+			_page.set_ref(name);
+			return _page.activate();
+		}
+	private:
+		REFLOG_PAGE _page;
+};
+
+// reflog menu
+class REFLOG_MENU : public HCI_MENU {
 	public:
-		APPLICATION() : HCI_APPLICATION(), _main_menu(*this), _side_menu(*this) {
+		explicit REFLOG_MENU(HCI_APPLICATION& ctx)
+			: HCI_MENU(ctx, "reflog"), _head("reflog of HEAD", "HEAD") {
+			add(0x1b, &hci_esc);
+			add('b', &hci_up);
+			add('h', &_head);
+			add('r', &_branch);
 		}
+
 	public:
 		void show() {
-		// shows a menu to create a repository if a repository is not present
-			if (exists == false) {
-				try {
-					_side_menu.enter();
-				}
-				catch (HCI_ESCAPE const&) {
-					// escape pressed
+			out() << "-------------------------\n";
+			out() << "Reflog\n";
+			out() << "-------------------------\n\n";
+			HCI_MENU::show();
+			out() << "\n";
+		}
+	private:
+		REFLOG_PAGE _head;
+		BRANCH_REFLOG _branch;
+};
+
+// search results, one line per hit, in path order. rows are collected as
+// the pager gets to them, while the search goes on in the background.
+class GREP_PAGE : public HCI_PAGER {
+	public:
+		explicit GREP_PAGE(string const& name) : HCI_PAGER(name), _next(0) {}
+	public:
+		void start(string const& rev, vector<string> const& literals) {
+			_grep.reset();
+			_rows.clear();
+			_next = 0;
+			_rev = rev;
+			_repo.reset(new REPO);
+			_grep.reset(new GREP(*_repo, _repo->commit_id(rev), literals));
+		}
+		HCI_NAV key(int c) {
+			HCI_NAV n = HCI_PAGER::key(c);
+			if (n.op() == HCI_NAV::_pop) {
+				// stop searching
+				_grep.reset();
+			} else {
+			}
+			return n;
+		}
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Search at " << _rev << "\n\n";
+			HCI_PAGER::show();
+			out() << "-------------------------\n";
+		}
+	private:
+		bool lines(ostream& o, size_t top, size_t n) {
+			// one row past the window, to know if there is more
+			while (_rows.size() <= top + n && _next < _grep->size()) {
+				auto const& h = _grep->hits(_next);
+				for (size_t i = 0; i < h.size(); ++i) {
+					_rows.push_back(make_pair(_next, i));
 				}
+				++_next;
 			}
 
-		REPO r;
+			if (_rows.empty()) {
+				o << "no matches\n";
+			} else {
+			}
+			for (size_t i = top; i < top + n && i < _rows.size(); ++i) {
+				auto const& h = _grep->hits(_rows[i].first)[_rows[i].second];
+				o << _grep->path(_rows[i].first) << ":" << h.line << ":" << h.text << "\n";
+			}
+			return _rows.size() > top + n;
+		}
+	private:
+		string _rev;
+		unique_ptr<REPO> _repo;
+		unique_ptr<GREP> _grep;
+		vector<pair<size_t, size_t> > _rows; // file, hit
+		size_t _next; // file
+};
 
-		// shows the main menu
+// asks what to search for, then shows the results
+class GREP_ACTION : public HCI_ACTION {
+	public:
+		GREP_ACTION() : HCI_ACTION("search files"), _page("search results") {}
+	private:
+		HCI_NAV do_it() {
+			string rev;
+			vector<string> literals;
+
+			out() << "Revision (empty for HEAD): ";
+			getstring(rev);
+			out() << "\nSearch for, one string per line, empty line to start:\n";
+			for (;;) {
+				string l;
+				getstring(l);
+				out() << "\n";
+				if (l.empty()) {
+					break;
+				} else {
+					literals.push_back(l);
+				}
+			}
+
+			if (literals.empty()) {
+				out() << "Nothing to search for\n";
+				return HCI_NAV();
+			} else {
+			}
 			try {
-				_main_menu.enter();
+				_page.start(rev.size() ? rev : "HEAD", literals);
 			}
-			catch (HCI_ESCAPE const&) {
-				// escape pressed
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+				return HCI_NAV();
 			}
+			return _page.activate();
 		}
+	private:
+		GREP_PAGE _page;
+};
+
+// the n largest blobs in the history of range
+static void print_largest(ostream& o, REPO& r, size_t n, string const& range)
+{
+	LARGEST_BLOBS l(r, n, range);
+	auto ix = r.oid_index();
+	for (auto const& e : l.result()) {
+		o << setw(10) << e.size << " " << ix->short_id(e.id) << " "
+			<< ix->short_id(e.commit) << " " << e.path << "\n";
+	}
+	o << "\n" << l.commits() << " commits\n";
+}
 
+// largest blobs page
+class LARGEST_PAGE : public HCI_PAGE {
+	public:
+		LARGEST_PAGE(string const& name, PROFILE const& p)
+			: HCI_PAGE(name), _profile(p), _view(NOTIFY::_head, "largest") {}
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Largest Blobs\n\n";
+			out() << "     bytes blob    commit  path\n";
+			out() << _view.get([this](ostream& o) {
+				REPO r;
+				unique_ptr<PREFETCH> pf(prefetch(r, _profile, true));
+				print_largest(o, r, 20, "HEAD");
+			}, "20 HEAD");
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
 	private:
-		NOREPO_MENU _side_menu;
-		ISREPO_MENU _main_menu;
+		PROFILE const& _profile;
+		VIEW_CACHE _view;
 };
 
-// main program
-int main() {
+// the busiest files and directories of the last days on HEAD
+static void print_hotspots(ostream& o, REPO& r, unsigned days, size_t n)
+{
+	WALK_SPEC w("HEAD");
+	w.since(time(NULL) - git_time_t(days) * 86400);
+	HOTSPOTS h(r, w);
+
+	o << h.commits() << " commits in " << days << " days\n";
+	for (bool dirs : { false, true }) {
+		o << (dirs ? "\nDirectories\n" : "\nFiles\n");
+		o << "commits     added   removed  path\n";
+		for (auto const& i : h.top(n, dirs)) {
+			o << setw(7) << i.second.commits << " " << setw(9) << i.second.added << " "
+				<< setw(9) << i.second.removed << "  " << i.first << "\n";
+		}
+	}
+}
+
+// hotspots page, for the window set_days() was given
+class HOTSPOTS_PAGE : public HCI_PAGE {
+	public:
+		explicit HOTSPOTS_PAGE(string const& name)
+			: HCI_PAGE(name), _days(90), _view(NOTIFY::_head, "hotspots") {}
+	public:
+		void set_days(unsigned d) {
+			_days = d;
+		}
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Hotspots\n\n";
+			// the window moves with the day
+			string params = to_string(_days) + " " + to_string(time(NULL) / 86400);
+			out() << _view.get([this](ostream& o) {
+				REPO r;
+				print_hotspots(o, r, _days, 20);
+			}, params);
+			out() << "\nPress any key to leave\n";
+			out() << "-------------------------\n";
+		}
+	private:
+		unsigned _days;
+		VIEW_CACHE _view;
+};
+
+// asks for the window, then shows the hotspots
+class HOTSPOTS_ACTION : public HCI_ACTION {
+	public:
+		HOTSPOTS_ACTION() : HCI_ACTION("hotspots"), _page("hotspots") {}
+	private:
+		HCI_NAV do_it() {
+			string days;
+			out() << "Days (empty for 90): ";
+			getstring(days);
+			out() << "\n";
+			unsigned d = days.size() ? strtoul(days.c_str(), NULL, 10) : 90;
+			if (!d) {
+				out() << "Not a number of days\n";
+				return HCI_NAV();
+			} else {
+			}
+			_page.set_days(d);
+			return _page.activate();
+		}
+	private:
+		HOTSPOTS_PAGE _page;
+};
+
+// a bar of c out of most, then the count
+static void print_bar(ostream& o, uint32_t c, uint32_t most, unsigned width = 50)
+{
+	unsigned w = most ? unsigned(uint64_t(c) * width / most) : 0;
+	o << string(w, '#') << (c && !w ? "." : "") << " " << c << "\n";
+}
+
+// commits per day, per week and per hour of the week on HEAD, for everyone
+// or the authors matching what 'a' asked for. the counts are kept between
+// visits, coming back only walks the new commits.
+class ACTIVITY_PAGE : public HCI_PAGE {
+	public:
+		explicit ACTIVITY_PAGE(string const& name)
+			: HCI_PAGE(name), _view(NOTIFY::_head) {}
+	public:
+		void show() {
+			REPO r;
+			_activity.update(r);
+			// up to date, until notify says otherwise
+			_view.get([](ostream&) {});
+
+			out() << "-------------------------\n";
+			out() << "Activity\n\n";
+			out() << _activity.size() << " commits by " << _activity.authors().size() << " authors";
+			if (_author.size()) {
+				out() << ", showing " << _author;
+			} else {
+			}
+			out() << "\n";
+
+			git_time_t first = _activity.first();
+			char date[32];
+			auto days = _activity.histogram(ACTIVITY::_day, _author);
+			out() << "\nLast days\n";
+			size_t b = days.size() - std::min(days.size(), size_t(14));
+			uint32_t most = days.size() ? *std::max_element(days.begin() + b, days.end()) : 0;
+			for (size_t i = b; i < days.size(); ++i) {
+				time_t s = first + git_time_t(i) * 86400;
+				strftime(date, sizeof(date), "%Y-%m-%d %a", gmtime(&s));
+				out() << date << " ";
+				print_bar(out(), days[i], most);
+			}
+
+			auto weeks = _activity.histogram(ACTIVITY::_week, _author);
+			out() << "\nLast weeks\n";
+			b = weeks.size() - std::min(weeks.size(), size_t(12));
+			most = weeks.size() ? *std::max_element(weeks.begin() + b, weeks.end()) : 0;
+			for (size_t i = b; i < weeks.size(); ++i) {
+				time_t s = first + git_time_t(i) * 7 * 86400;
+				strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&s));
+				out() << date << "     ";
+				print_bar(out(), weeks[i], most);
+			}
+
+			// darker is busier
+			static char const shade[] = " .:-=+*#%@";
+			auto hours = _activity.histogram(ACTIVITY::_hour_of_week, _author);
+			most = *std::max_element(hours.begin(), hours.end());
+			out() << "\nHour of the week\n";
+			out() << "     0     6     12    18\n";
+			static char const* const day[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+			for (unsigned d = 0; d < 7; ++d) {
+				out() << day[d] << "  ";
+				for (unsigned h = 0; h < 24; ++h) {
+					uint32_t c = hours[d * 24 + h];
+					out() << shade[most ? (uint64_t(c) * 9 + most - 1) / most : 0];
+				}
+				out() << "\n";
+			}
+
+			out() << "\nPress 'a' to pick authors, any other key to leave\n";
+			out() << "-------------------------\n";
+		}
+		HCI_NAV key(int c) {
+			if (c != 'a') {
+				return HCI_PAGE::key(c);
+			} else {
+			}
+
+			_author.clear();
+			out() << "Part of author name or email (empty for all): ";
+			getstring(_author);
+			out() << "\n";
+			draw();
+			return HCI_NAV();
+		}
+	private:
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				draw();
+			} else {
+			}
+		}
+	private:
+		ACTIVITY _activity;
+		string _author;
+		VIEW_CACHE _view;
+};
+
+// asks where to, then clones the repository there
+class CLONE_ACTION : public HCI_ACTION {
+	public:
+		CLONE_ACTION() : HCI_ACTION("clone") {}
+	private:
+		HCI_NAV do_it() {
+			string path;
+			string files;
+			out() << "Clone to: ";
+			getstring(path);
+			out() << "\nCheck out files (y/n, empty for y): ";
+			getstring(files);
+			out() << "\n";
+			if (path.empty()) {
+				out() << "No path\n";
+				return HCI_NAV();
+			} else {
+			}
+
+			auto t0 = chrono::steady_clock::now();
+			try {
+				REPO r;
+				CLONE c(r, path, files != "n");
+				chrono::duration<double> d = chrono::steady_clock::now() - t0;
+				ostringstream s;
+				s << fixed << setprecision(2) << d.count();
+				out() << "Cloned to " << path << ", " << c.files() << " files checked out, in "
+					<< s.str() << "s\n";
+			}
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+			}
+			return HCI_NAV();
+		}
+};
+
+// object store sizes, before and after a repack
+static void print_objects(ostream& o, STATS const& s)
+{
+	o << s.loose_count() << " loose objects, " << s.loose_size() / 1024 << " KiB, "
+		<< s.packs().size() << " packs, " << s.pack_size() / 1024 << " KiB\n";
+}
+
+// packs the loose objects, showing the progress
+static void repack(ostream& o, REPO& r)
+{
+	o << "before: ";
+	print_objects(o, r.stats());
+	REPACK p(r, 0, [&o](char const* stage, size_t done, size_t total) {
+		o << "\r" << stage << " " << done << "/" << total << "          ";
+		o.flush();
+	});
+	o << "\npacked " << p.objects() << " objects\n";
+	o << "after:  ";
+	print_objects(o, r.stats());
+}
+
+// packs the loose objects when there are more than hci.autoPack
+static void autopack(REPO& r, PROFILE const& p)
+{
+	int64_t n = p.get("hci.autopack", 0);
+	if (n <= 0) {
+	} else if (r.stats().loose_count() <= size_t(n)) {
+	} else {
+		try {
+			repack(cerr, r);
+		}
+		catch (EXCEPTION const& e) { untested();
+			cerr << e.what() << "\n";
+		}
+	}
+}
+
+// the "pack loose objects" action
+class REPACK_ACTION : public HCI_ACTION {
+	public:
+		REPACK_ACTION() : HCI_ACTION("pack loose objects") {}
+	private:
+		HCI_NAV do_it() {
+			try {
+				REPO r;
+				repack(out(), r);
+			}
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+			}
+			return HCI_NAV();
+		}
+};
+
+// what a STAGE did, a screen at a time
+class STAGE_PAGE : public HCI_PAGER {
+	public:
+		explicit STAGE_PAGE(string const& name) : HCI_PAGER(name), _added(0), _removed(0), _unchanged(0) {}
+	public:
+		void stage(vector<string> const& pathspecs) {
+			REPO r;
+			STAGE s(r, pathspecs);
+			_rows.clear();
+			for (auto const& p : s.added()) {
+				_rows.push_back("A " + p);
+			}
+			for (auto const& p : s.removed()) {
+				_rows.push_back("D " + p);
+			}
+			_added = s.added().size();
+			_removed = s.removed().size();
+			_unchanged = s.unchanged();
+		}
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Staged " << _added << " files, removed " << _removed << ", "
+				<< _unchanged << " unchanged\n\n";
+			HCI_PAGER::show();
+			out() << "-------------------------\n";
+		}
+	private:
+		bool lines(ostream& o, size_t top, size_t n) {
+			if (_rows.empty()) {
+				o << "nothing to stage\n";
+			} else {
+			}
+			for (size_t i = top; i < top + n && i < _rows.size(); ++i) {
+				o << _rows[i] << "\n";
+			}
+			return _rows.size() > top + n;
+		}
+	private:
+		vector<string> _rows;
+		size_t _added;
+		size_t _removed;
+		size_t _unchanged;
+};
+
+// asks for paths or globs, stages them and shows what changed
+class STAGE_ACTION : public HCI_ACTION {
+	public:
+		STAGE_ACTION() : HCI_ACTION("stage files"), _page("staged") {}
+	private:
+		HCI_NAV do_it() {
+			vector<string> pathspecs;
+			out() << "Paths or globs to stage, one per line, empty line to start:\n";
+			for (;;) {
+				string l;
+				getstring(l);
+				out() << "\n";
+				if (l.empty()) {
+					break;
+				} else {
+					pathspecs.push_back(l);
+				}
+			}
+
+			if (pathspecs.empty()) {
+				out() << "Nothing to stage\n";
+				return HCI_NAV();
+			} else {
+			}
+			try {
+				_page.stage(pathspecs);
+			}
+			catch (EXCEPTION const& e) {
+				out() << e.what() << "\n";
+				return HCI_NAV();
+			}
+			return _page.activate();
+		}
+	private:
+		STAGE_PAGE _page;
+};
+
+// menu to create a new repository
+class NOREPO_MENU : public HCI_MENU {
+	public:
+		explicit NOREPO_MENU(HCI_APPLICATION& ctx)
+			: HCI_MENU(ctx, "norepo") {
+			add(0x1b, &hci_esc);
+			add('y', &hci_create);
+			add('n', &hci_leave);
+		}
+
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "No repository found\n";
+			out() << "-------------------------\n\n";
+			HCI_MENU::show();
+			out() << "\n";
+		}
+};
+
+// configure repository menu
+class EDIT_MENU : public HCI_MENU {
+	public:
+		explicit EDIT_MENU(HCI_APPLICATION& ctx)
+			: HCI_MENU(ctx, "configure repository"), _view(NOTIFY::_config) {
+			add(0x1b, &hci_esc);
+			add('a', &make_variable);
+			add('b', &hci_up);
+		}
+
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Configure Repository\n";
+			out() << "-------------------------\n\n";
+			out() << "Your Git repository in <CWD>\n\n";
+
+			out() << _view.get([](ostream& o) {
+				REPO r;
+				int count = 1;
+
+				for (auto i : r.config()) {
+					o << to_string(count) << ". " << i << "\n";
+					count += 1;
+				}
+			});
+
+			out() << "\nWould you like to create a new configuration variable?\n";
+			out() << "(Press 'a' to create one and 'b' to go back to the previous menu";
+			out() << "\n\n";
+			HCI_MENU::show();
+			out() << "\n";
+		}
+	private:
+		int event_fd() { return _view.fd(); }
+		void event() {
+			if (_view.stale()) {
+				clear();
+				show();
+			} else {
+			}
+		}
+	private:
+		MAKE_VARIABLE make_variable;
+		VIEW_CACHE _view;
+};
+
+// main menu
+class ISREPO_MENU : public HCI_MENU {
+	public:
+		explicit ISREPO_MENU(HCI_APPLICATION& ctx, PROFILE const& p)
+			: HCI_MENU(ctx, "isrepo"), _list_config("list config", p),
+		_edit_menu(ctx), _list_commit("list commits", p), _health("repository health", p),
+		_status("working tree status"), _branches("list branches"),
+		_diagnostics("diagnostics", p), _tags(ctx), _reflog(ctx), _largest("largest blobs", p),
+		_activity("activity") {
+			add(0x1b, &hci_esc);
+			add('a', &_activity);
+			add('b', &_branches);
+			add('c', &_list_config);
+			add('d', &_diagnostics);
+			add('e', &_edit_menu);
+			add('g', &_grep);
+			add('h', &_health);
+			add('i', &_stage);
+			add('k', &_hotspots);
+			add('l', &_list_commit);
+			add('n', &_clone);
+			add('o', &_largest);
+			add('p', &_repack);
+			add('q', &hci_quit);
+			add('r', &_reflog);
+			add('s', &_status);
+			add('t', &_tags);
+		}
+
+	public:
+		void show() {
+			out() << "-------------------------\n";
+			out() << "Your Git repository\n";
+			out() << "-------------------------\n\n";
+			HCI_MENU::show();
+			out() << "\n";
+		}
+	private:
+		LISTCONFIG_PAGE _list_config;
+		EDIT_MENU _edit_menu;
+		LISTCOMMIT_PAGE _list_commit;
+		HEALTH_PAGE _health;
+		STATUS_PAGE _status;
+		BRANCHES_PAGE _branches;
+		DIAGNOSTICS_PAGE _diagnostics;
+		TAGS_MENU _tags;
+		REFLOG_MENU _reflog;
+		GREP_ACTION _grep;
+		LARGEST_PAGE _largest;
+		HOTSPOTS_ACTION _hotspots;
+		ACTIVITY_PAGE _activity;
+		CLONE_ACTION _clone;
+		REPACK_ACTION _repack;
+		STAGE_ACTION _stage;
+};
+
+// fuzzy finder over branches, commit subjects and config names, '/' in
+// any menu. candidates are read again after the repository changed.
+class FINDER : public HCI_FINDER {
+	public:
+		FINDER()
+			: HCI_FINDER("find"),
+			_view(NOTIFY::_head | NOTIFY::_refs | NOTIFY::_config) {}
+	private:
+		void load() {
+			unsigned branch = kind("branch");
+			unsigned commit = kind("commit");
+			unsigned config = kind("config");
+			REPO r;
+			for (auto b : r.branches()) {
+				add(branch, b.name_view().str());
+			}
+			auto ix = r.oid_index();
+			for (auto c : r.commits()) {
+				add(commit, ix->short_id(c.oid()) + " " + c.message_view().line().str());
+			}
+			for (auto i : r.config()) {
+				add(config, i.name_view().str());
+			}
+			// loaded, until notify says otherwise
+			_view.get([](ostream&) {});
+		}
+		bool stale() {
+			return _view.stale();
+		}
+		HCI_NAV chosen(unsigned k, string const& text) {
+			out() << "\nPicked " << kind_name(k) << " " << text << "\n";
+			return HCI_NAV();
+		}
+	private:
+		VIEW_CACHE _view;
+};
+
+class APPLICATION : public HCI_APPLICATION {
+	public:
+		explicit APPLICATION(PROFILE const& p)
+			: HCI_APPLICATION(), _side_menu(*this), _main_menu(*this, p) {
+		}
+	public:
+		void show() {
+		// shows a menu to create a repository if a repository is not present
+			if (exists == false && !navigate(_side_menu)) {
+				return;
+			} else {
+			}
+
+		REPO r;
+
+		try {
+			notify.reset(new NOTIFY(r));
+		}
+		catch (EXCEPTION const&) { untested();
+			// no inotify. views are rebuilt every time.
+		}
+		set_finder(&_finder);
+
+		// shows the main menu
+			navigate(_main_menu);
+		}
+
+	private:
+		NOREPO_MENU _side_menu;
+		ISREPO_MENU _main_menu;
+		FINDER _finder;
+};
+
+// summary of a repository, for scan mode
+struct REPO_SUMMARY {
+	REPO_SUMMARY() : branches(0), keys(0), dirty(false) {}
+	string path;
+	string head;
+	size_t branches;
+	size_t keys;
+	bool dirty;
+	string error;
+};
+
+// find all repositories below root and summarise them on all cores. no more
+// than max_fds files are held open at a time: half for libgit2's pack
+// files, half for the rest. RLIMIT_NOFILE holds it to that, going over
+// fails with EMFILE and shows as an error.
+static int scan(string const& root, string const& sort, size_t max_fds)
+{
+	// open while a repository is summarised, besides packs: the file being
+	// read (HEAD, refs, config, index, a loose object, a work tree file to
+	// hash), each closed after, and the directory the status scan lists.
+	size_t const per_repo = 2;
+	if (max_fds < 4 * per_repo) { untested();
+		max_fds = 4 * per_repo;
+	} else {
+	}
+
+	size_t open_now = 0;
+	if (DIR* d = opendir("/proc/self/fd")) {
+		while (struct dirent* e = readdir(d)) {
+			open_now += e->d_name[0] != '.';
+		}
+		closedir(d);
+		// d itself
+		--open_now;
+	} else { untested();
+	}
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl)) { untested();
+	} else {
+		rl.rlim_cur = min(rl.rlim_max, rlim_t(open_now + max_fds));
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	git_libgit2_init();
+	git_libgit2_opts(GIT_OPT_SET_MWINDOW_FILE_LIMIT, size_t(max_fds / 2));
+	SEMAPHORE fds(max_fds / 2);
+	POOL pool;
+	mutex m;
+	vector<REPO_SUMMARY> result;
+
+	pool.run_tasks(vector<string>(1, root), [&](string const& dir, unsigned,
+				function<void(string const&)>& push) {
+		struct stat st;
+		bool is_repo = !lstat((dir + "/.git").c_str(), &st)
+			|| (!stat((dir + "/HEAD").c_str(), &st) && !stat((dir + "/objects").c_str(), &st)
+					&& !stat((dir + "/refs").c_str(), &st));
+
+		if (is_repo) {
+			REPO_SUMMARY s;
+			s.path = dir;
+
+			fds.acquire(per_repo);
+			try {
+				REPO r(dir);
+				auto c = r.commits();
+				auto h = c.begin();
+				if (h != c.end()) {
+					s.head = (*h).id().substr(0, 12);
+				} else { untested();
+				}
+				for (auto b : r.branches()) {
+					(void)b;
+					++s.branches;
+				}
+				for (auto i : r.config()) {
+					(void)i;
+					++s.keys;
+				}
+				s.dirty = r.dirty();
+			}
+			catch (EXCEPTION const& e) { untested();
+				s.error = e.what();
+			}
+			fds.release(per_repo);
+
+			lock_guard<mutex> l(m);
+			result.push_back(s);
+			return;
+		} else {
+		}
+
+		fds.acquire();
+		if (DIR* d = opendir(dir.c_str())) {
+			while (struct dirent* e = readdir(d)) {
+				string n(e->d_name);
+				string p = dir + "/" + n;
+				if (n == "." || n == "..") {
+				} else if (e->d_type == DT_DIR) {
+					push(p);
+				} else if (e->d_type != DT_UNKNOWN) {
+				} else if (!lstat(p.c_str(), &st) && S_ISDIR(st.st_mode)) { untested();
+					push(p);
+				} else {
+				}
+			}
+			closedir(d);
+		} else if (errno == EMFILE) { untested();
+			REPO_SUMMARY s;
+			s.path = dir;
+			s.error = "can't list, " + string(strerror(errno));
+			lock_guard<mutex> l(m);
+			result.push_back(s);
+		} else { untested();
+		}
+		fds.release();
+	});
+
+	git_libgit2_shutdown();
+
+	std::sort(result.begin(), result.end(), [&](REPO_SUMMARY const& a, REPO_SUMMARY const& b) {
+		if (sort == "head") {
+			return a.head < b.head;
+		} else if (sort == "branches") {
+			return a.branches > b.branches;
+		} else if (sort == "keys") {
+			return a.keys > b.keys;
+		} else if (sort == "dirty") {
+			return a.dirty > b.dirty;
+		} else {
+			return a.path < b.path;
+		}
+	});
+
+	cout << left << setw(13) << "HEAD" << right << setw(9) << "BRANCHES"
+		<< setw(6) << "KEYS" << " DIRTY PATH\n";
+	for (auto const& s : result) {
+		cout << left << setw(13) << s.head << right << setw(9) << s.branches
+			<< setw(6) << s.keys << (s.dirty ? "   *  " : "      ") << s.path;
+		if (s.error.size()) { untested();
+			cout << " (" << s.error << ")";
+		} else {
+		}
+		cout << "\n";
+	}
+	cout << result.size() << " repositories\n";
+
+	return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+// daemon mode. keeps repositories open and answers queries on a unix socket.
+//
+// a message is a 32 bit length in network byte order, then that many bytes.
+// requests are '\0' separated fields, command, repository path, arguments:
+//   log <repo> [<range> [<max>]]     id, author, seconds, summary per line
+//   config-get <repo> <name>         the value
+//   config-set <repo> <name> <value>
+//   branches <repo>                  one per line, '*' marks HEAD
+//   status <repo>                    as on the status page
+// responses start with 'o' (ok) or 'e' (error), then the text. fields are
+// separated by tabs.
+
+// an open repository, used by one worker at a time
+struct WARM_REPO {
+	explicit WARM_REPO(string const& path) : repo(path), status(repo, true) {}
+	mutex lock;
+	REPO repo;
+	STATUS status;
+};
+
+static string answer(map<string, unique_ptr<WARM_REPO> >& repos, string const& req)
+{
+	vector<string> a;
+	for (size_t b = 0, e; b <= req.size(); b = e + 1) {
+		e = req.find('\0', b);
+		if (e == string::npos) {
+			e = req.size();
+		} else {
+		}
+		a.push_back(req.substr(b, e - b));
+	}
+
+	auto r = a.size() < 2 ? repos.end() : repos.find(a[1]);
+	if (r == repos.end()) {
+		return "eunknown repository";
+	} else {
+	}
+
+	WARM_REPO& w = *r->second;
+	lock_guard<mutex> l(w.lock);
+	ostringstream o;
+	o << 'o';
+
+	try {
+		if (a[0] == "log") {
+			size_t max = a.size() > 3 ? strtoul(a[3].c_str(), NULL, 10) : 0;
+			for (auto i : w.repo.commits(a.size() > 2 ? a[2] : "HEAD")) {
+				o << i << '\t' << i.author_view() << '\t' << i.seconds() << '\t'
+					<< i.message_view().line() << '\n';
+				if (max && !--max) {
+					break;
+				} else {
+				}
+			}
+		} else if (a[0] == "config-get" && a.size() == 3) {
+			o << w.repo.config()[a[2]].value();
+		} else if (a[0] == "config-set" && a.size() == 4) {
+			auto c = w.repo.config();
+			try {
+				c[a[2]] = a[3];
+			}
+			catch (EXCEPTION_CANT_FIND const&) {
+				c.create(a[2]) = a[3];
+			}
+		} else if (a[0] == "branches") {
+			for (auto b : w.repo.branches()) {
+				o << (b.is_head() ? "* " : "  ") << b << '\n';
+			}
+		} else if (a[0] == "status") {
+			w.status.refresh();
+			for (auto const& e : w.status.entries()) {
+				o << e << '\n';
+			}
+		} else {
+			return "ebad request " + a[0];
+		}
+	}
+	catch (EXCEPTION const& e) {
+		return string("e") + e.what();
+	}
+
+	return o.str();
+}
+
+static string frame(string const& s)
+{
+	uint32_t n = htonl(uint32_t(s.size()));
+	return string(reinterpret_cast<char const*>(&n), 4) + s;
+}
+
+// serve queries for repos on socket path. an epoll loop does the I/O,
+// workers answer. requests on a connection are answered in order. runs
+// until SIGTERM or SIGINT, then removes the socket.
+static int serve(string const& path, vector<string> const& paths, unsigned workers)
+{
+	map<string, unique_ptr<WARM_REPO> > repos;
+	for (auto const& p : paths) {
+		try {
+			repos[p].reset(new WARM_REPO(p));
+		}
+		catch (EXCEPTION const& e) {
+			cerr << p << ": " << e.what() << "\n";
+			return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	unlink(path.c_str());
+
+	// larger requests close the connection
+	size_t const max_request = 1 << 20;
+
+	// stop signals arrive on sig. blocked before the workers start, so
+	// that they inherit the mask.
+	sigset_t stop_signals;
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGTERM);
+	sigaddset(&stop_signals, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+	int sig = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) { untested();
+		cerr << "socket path too long\n";
+		return 1;
+	} else {
+	}
+	strcpy(addr.sun_path, path.c_str());
+
+	int ls = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+	int done = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ls < 0 || ep < 0 || done < 0 || sig < 0) { untested();
+		perror("daemon");
+		return 1;
+	} else if (bind(ls, (struct sockaddr*)&addr, sizeof(addr)) || listen(ls, 128)) { untested();
+		perror(path.c_str());
+		return 1;
+	} else {
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = ls;
+	epoll_ctl(ep, EPOLL_CTL_ADD, ls, &ev);
+	ev.data.fd = done;
+	epoll_ctl(ep, EPOLL_CTL_ADD, done, &ev);
+	ev.data.fd = sig;
+	epoll_ctl(ep, EPOLL_CTL_ADD, sig, &ev);
+
+	struct CONN {
+		CONN() : busy(false) {}
+		string in;
+		string out;
+		bool busy;
+	};
+	map<int, CONN> conns;
+
+	// work for the workers, (fd, request) in and (fd, response) out.
+	mutex qm;
+	condition_variable qc;
+	deque<pair<int, string> > jobs;
+	deque<pair<int, string> > results;
+	bool stop = false;
+
+	vector<thread> pool;
+	for (unsigned i = 0; i < workers; ++i) {
+		pool.emplace_back([&] {
+			for (;;) {
+				pair<int, string> j;
+				{
+					unique_lock<mutex> l(qm);
+					qc.wait(l, [&] { return stop || jobs.size(); });
+					if (stop) {
+						return;
+					} else {
+					}
+					j = jobs.front();
+					jobs.pop_front();
+				}
+				string r = frame(answer(repos, j.second));
+				{
+					lock_guard<mutex> l(qm);
+					results.push_back(make_pair(j.first, r));
+				}
+				uint64_t one = 1;
+				if (write(done, &one, sizeof(one)) < 0) { untested();
+				} else {
+				}
+			}
+		});
+	}
+
+	// fds of closed connections with a request in flight
+	set<int> closed;
+
+	// forget fd. its worker, if any, still answers, see closed.
+	auto drop = [&](int fd) {
+		epoll_ctl(ep, EPOLL_CTL_DEL, fd, NULL);
+		if (conns[fd].busy) {
+			// the fd must not be reused before the worker is done.
+			closed.insert(fd);
+		} else {
+			close(fd);
+			conns.erase(fd);
+		}
+	};
+
+	// hand the next complete request on fd to a worker, if idle.
+	auto next = [&](int fd) {
+		CONN& c = conns[fd];
+		uint32_t n;
+		if (c.busy || c.in.size() < 4) {
+			return;
+		} else {
+		}
+		memcpy(&n, c.in.data(), 4);
+		n = ntohl(n);
+		if (c.in.size() < 4 + size_t(n)) {
+			return;
+		} else {
+		}
+
+		c.busy = true;
+		lock_guard<mutex> l(qm);
+		jobs.push_back(make_pair(fd, c.in.substr(4, n)));
+		c.in.erase(0, 4 + n);
+		qc.notify_one();
+	};
+
+	// write what fits. false if the peer is gone and fd was dropped.
+	auto flush = [&](int fd) {
+		CONN& c = conns[fd];
+		while (c.out.size()) {
+			ssize_t n = write(fd, c.out.data(), c.out.size());
+			if (n > 0) {
+				c.out.erase(0, n);
+			} else if (n < 0 && errno == EAGAIN) {
+				break;
+			} else {
+				drop(fd);
+				return false;
+			}
+		}
+		struct epoll_event e;
+		e.events = EPOLLIN | (c.out.size() ? EPOLLOUT : 0);
+		e.data.fd = fd;
+		epoll_ctl(ep, EPOLL_CTL_MOD, fd, &e);
+		return true;
+	};
+
+	struct epoll_event events[64];
+	bool running = true;
+	while (running) {
+		int n = epoll_wait(ep, events, 64, -1);
+		if (n < 0 && errno != EINTR) { untested();
+			perror("epoll_wait");
+			break;
+		} else {
+		}
+		for (int i = 0; i < n; ++i) {
+			int fd = events[i].data.fd;
+			uint32_t what = events[i].events;
+
+			if (fd == sig) {
+				running = false;
+			} else if (fd == ls) {
+				int c;
+				while ((c = accept4(ls, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+					struct epoll_event e;
+					e.events = EPOLLIN;
+					e.data.fd = c;
+					epoll_ctl(ep, EPOLL_CTL_ADD, c, &e);
+					conns[c] = CONN();
+				}
+			} else if (fd == done) {
+				uint64_t k;
+				if (read(done, &k, sizeof(k)) < 0) { untested();
+				} else {
+				}
+				deque<pair<int, string> > r;
+				{
+					lock_guard<mutex> l(qm);
+					r.swap(results);
+				}
+				for (auto const& x : r) {
+					if (closed.erase(x.first)) {
+						close(x.first);
+						conns.erase(x.first);
+					} else {
+						conns[x.first].out += x.second;
+						conns[x.first].busy = false;
+						if (flush(x.first)) {
+							next(x.first);
+						} else {
+						}
+					}
+				}
+			} else if (!conns.count(fd)) { untested();
+				// dropped earlier in this batch
+			} else if (what & (EPOLLERR | EPOLLHUP)) {
+				drop(fd);
+			} else if ((what & EPOLLOUT) && !flush(fd)) {
+			} else if (what & EPOLLIN) {
+				CONN& c = conns[fd];
+				char buf[1 << 16];
+				ssize_t k;
+				while ((k = read(fd, buf, sizeof(buf))) > 0 && c.in.size() <= 4 * max_request) {
+					c.in.append(buf, k);
+				}
+				uint32_t len = 0;
+				if (c.in.size() >= 4) {
+					memcpy(&len, c.in.data(), 4);
+					len = ntohl(len);
+				} else {
+				}
+				if (k == 0 || (k < 0 && errno != EAGAIN)) {
+					drop(fd);
+				} else if (len > max_request || c.in.size() > 4 * max_request) {
+					// too large, or too many queued while busy
+					drop(fd);
+				} else {
+					next(fd);
+				}
+			} else {
+			}
+		}
+	}
+
+	{
+		lock_guard<mutex> l(qm);
+		stop = true;
+	}
+	qc.notify_all();
+	for (auto& t : pool) {
+		t.join();
+	}
+	for (auto const& c : conns) {
+		close(c.first);
+	}
+	close(ls);
+	close(done);
+	close(sig);
+	close(ep);
+	unlink(path.c_str());
+	return 0;
+}
+
+// send one request to a daemon, print the answer.
+static int query(string const& path, vector<string> const& args)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (s < 0 || connect(s, (struct sockaddr*)&addr, sizeof(addr))) {
+		perror(path.c_str());
+		return 1;
+	} else {
+	}
+
+	string req;
+	for (auto const& a : args) {
+		req += (req.size() ? string(1, '\0') : string()) + a;
+	}
+	req = frame(req);
+	if (write(s, req.data(), req.size()) != ssize_t(req.size())) { untested();
+		perror(path.c_str());
+		return 1;
+	} else {
+	}
+
+	string r;
+	char buf[1 << 16];
+	uint32_t n = 0;
+	for (ssize_t k; (r.size() < 4 || r.size() < 4 + size_t(n)) && (k = read(s, buf, sizeof(buf))) > 0; ) {
+		r.append(buf, k);
+		if (r.size() >= 4) {
+			memcpy(&n, r.data(), 4);
+			n = ntohl(n);
+		} else {
+		}
+	}
+	close(s);
+
+	if (r.size() < 5) { untested();
+		cerr << "no answer\n";
+		return 1;
+	} else if (r[4] == 'o') {
+		cout << r.substr(5);
+		return 0;
+	} else {
+		cerr << r.substr(5) << "\n";
+		return 1;
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+// write the log of the repository in the current directory to output, or
+// stdout.
+static int export_log(string const& format, string const& output, WALK_SPEC const& spec,
+		bool abbrev, PROFILE const& profile)
+{
+	EXPORT::format_t f = EXPORT::_ndjson;
+	if (format == "ndjson") {
+	} else if (format == "binary") {
+		f = EXPORT::_binary;
+	} else {
+		cerr << "unknown format " << format << "\n";
+		return 2;
+	}
+
+	int fd = STDOUT_FILENO;
+	if (output.empty()) {
+	} else if ((fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) < 0) {
+		perror(output.c_str());
+		return 1;
+	} else {
+	}
+
+	int ret = 0;
+	try {
+		REPO r;
+		unique_ptr<PREFETCH> pf(prefetch(r, profile));
+		auto c = r.commits(spec);
+		auto ix = abbrev ? r.oid_index() : nullptr;
+		WRITER w(fd);
+		EXPORT(w, f, ix.get())(c);
+	}
+	catch (EXCEPTION const& e) {
+		cerr << e.what() << "\n";
+		ret = 1;
+	}
+
+	if (fd != STDOUT_FILENO && close(fd)) { untested();
+		perror(output.c_str());
+		ret = 1;
+	} else {
+	}
+	return ret;
+}
+
+static int usage(char const* name)
+{
+	cerr << "usage: " << name << " [-c <key>=<value>]... [--timing]\n";
+	cerr << "       " << name << " --scan <root> [--sort=path|head|branches|keys|dirty]"
+		" [--max-fds=<n>]\n";
+	cerr << "       " << name << " --daemon <socket> [--workers=<n>] <repo>...\n";
+	cerr << "       " << name << " --query <socket> <command> <repo> [<arg>...]\n";
+	cerr << "       " << name << " --export ndjson|binary [--abbrev] [--output=<file>] [<walk>...] [<range>...]\n";
+	cerr << "  <walk>: --max-count=<n> --since=<time> --until=<time> --author=<s>\n";
+	cerr << "          --first-parent --topo-order --date-order --reverse\n";
+	cerr << "       " << name << " --largest=<n> [<range>]\n";
+	cerr << "       " << name << " --hotspots=<days>\n";
+	cerr << "       " << name << " --clone=<path> [--no-checkout]\n";
+	cerr << "       " << name << " --repack\n";
+	return 2;
+}
+
+// main program
+int main(int argc, char const* argv[]) {
+	string scan_root;
+	string sort = "path";
+	size_t max_fds = 256;
+	string sock_path;
+	vector<string> paths;
+	unsigned workers = thread::hardware_concurrency();
+	string format;
+	string output;
+	string range;
+	WALK_SPEC walk("");
+	unsigned sorting = GIT_SORT_NONE;
+	bool timing = false;
+	bool abbrev = false;
+	size_t largest = 0;
+	string clone;
+	bool checkout = true;
+	bool pack = false;
+	unsigned hotspots = 0;
+	PROFILE profile;
+
+	// settings from the repository in the current directory, if there is one.
+	// command line settings take precedence.
+	try {
+		REPO r;
+		auto c = r.config();
+		profile.load(c);
+	}
+	catch (EXCEPTION const&) {
+	}
+
+	if (argc > 3 && string(argv[1]) == "--query") {
+		return query(argv[2], vector<string>(argv + 3, argv + argc));
+	} else {
+	}
+
+	for (int i = 1; i < argc; ++i) {
+		string a = argv[i];
+		if (a == "--scan" && i + 1 < argc) {
+			scan_root = argv[++i];
+		} else if (a == "--daemon" && i + 1 < argc) {
+			sock_path = argv[++i];
+		} else if (!a.compare(0, 10, "--workers=")) {
+			workers = strtoul(a.c_str() + 10, NULL, 10);
+		} else if (sock_path.size() && a[0] != '-') {
+			paths.push_back(a);
+		} else if (a == "--export" && i + 1 < argc) {
+			format = argv[++i];
+		} else if (!a.compare(0, 9, "--output=")) {
+			output = a.substr(9);
+		} else if (a == "--abbrev") {
+			abbrev = true;
+		} else if (!a.compare(0, 11, "--hotspots=")) {
+			hotspots = strtoul(a.c_str() + 11, NULL, 10);
+		} else if (!a.compare(0, 8, "--clone=")) {
+			clone = a.substr(8);
+		} else if (a == "--no-checkout") {
+			checkout = false;
+		} else if (a == "--repack") {
+			pack = true;
+		} else if (!a.compare(0, 10, "--largest=")) {
+			largest = strtoul(a.c_str() + 10, NULL, 10);
+		} else if ((format.size() || largest) && a[0] != '-') {
+			range += " " + a;
+		} else if (!a.compare(0, 12, "--max-count=")) {
+			walk.max_count(strtoul(a.c_str() + 12, NULL, 10));
+		} else if (!a.compare(0, 8, "--since=") || !a.compare(0, 8, "--until=")) {
+			try {
+				git_time_t t = WALK_SPEC::parse_time(a.substr(8));
+				if (a[2] == 's') {
+					walk.since(t);
+				} else {
+					walk.until(t);
+				}
+			}
+			catch (EXCEPTION const& e) {
+				cerr << e.what() << "\n";
+				return 2;
+			}
+		} else if (!a.compare(0, 9, "--author=")) {
+			walk.author(a.substr(9));
+		} else if (a == "--first-parent") {
+			walk.first_parent(true);
+		} else if (a == "--topo-order") {
+			sorting |= GIT_SORT_TOPOLOGICAL;
+		} else if (a == "--date-order") {
+			sorting |= GIT_SORT_TIME;
+		} else if (a == "--reverse") {
+			sorting |= GIT_SORT_REVERSE;
+		} else if (a == "--timing") {
+			timing = true;
+		} else if (a == "-c" && i + 1 < argc) {
+			string kv = argv[++i];
+			size_t eq = kv.find('=');
+			if (eq == string::npos || !profile.set(kv.substr(0, eq), kv.substr(eq + 1))) {
+				cerr << "unknown setting " << kv << "\n";
+				return 2;
+			} else {
+			}
+		} else if (!a.compare(0, 7, "--sort=")) {
+			sort = a.substr(7);
+		} else if (!a.compare(0, 10, "--max-fds=")) {
+			max_fds = strtoul(a.c_str() + 10, NULL, 10);
+		} else {
+			return usage(argv[0]);
+		}
+	}
+
+	profile.apply();
+
+	// the revisions, with the walk options around them
+	WALK_SPEC revs(range.size() ? range : "HEAD");
+	for (auto const& i : revs.includes()) {
+		walk.include(i);
+	}
+	for (auto const& x : revs.excludes()) {
+		walk.exclude(x);
+	}
+	walk.sort(sorting);
+	if (range.empty()) {
+		range = "HEAD";
+	} else {
+		range = range.substr(1);
+	}
+
+	if (scan_root.size()) {
+		return scan(scan_root, sort, max_fds);
+	} else if (sock_path.size()) {
+		return serve(sock_path, paths, workers ? workers : 1);
+	} else if (format.size()) {
+		return export_log(format, output, walk, abbrev, profile);
+	} else if (hotspots) {
+		try {
+			REPO r;
+			print_hotspots(cout, r, hotspots, 50);
+			return 0;
+		}
+		catch (EXCEPTION const& e) {
+			cerr << e.what() << "\n";
+			return 1;
+		}
+	} else if (clone.size()) {
+		try {
+			REPO r;
+			CLONE c(r, clone, checkout, workers);
+			return 0;
+		}
+		catch (EXCEPTION const& e) {
+			cerr << e.what() << "\n";
+			return 1;
+		}
+	} else if (pack) {
+		try {
+			REPO r;
+			repack(cout, r);
+			return 0;
+		}
+		catch (EXCEPTION const& e) {
+			cerr << e.what() << "\n";
+			return 1;
+		}
+	} else if (largest) {
+		try {
+			REPO r;
+			unique_ptr<PREFETCH> pf(prefetch(r, profile, true));
+			print_largest(cout, r, largest, range);
+			return 0;
+		}
+		catch (EXCEPTION const& e) {
+			cerr << e.what() << "\n";
+			return 1;
+		}
+	} else {
+	}
+
   // tries to retrieve a repository
 	try {
 		REPO r;
 		exists = true;
+		autopack(r, profile);
 	}
 	catch (EXCEPTION_CANT_FIND& e) {
 
 	}
 
   // starts the application
-	APPLICATION application;
+	APPLICATION application(profile);
+	application.set_timing(timing);
 	return application.exec();
 }
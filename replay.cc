@@ -0,0 +1,376 @@
+// replay key presses into main over a pseudo terminal, against generated
+// repositories of growing size, and report the time from a key press to
+// the finished screen, per screen.
+//
+//   ./replay [--program=./main] [--dir=/tmp/hci-replay] [--sizes=100,1000,10000]
+//            [--rounds=20] [--max-p95=<ms>]
+//
+// a screen is finished when its title was printed and main waits for the
+// next key again, which is when it turns off canonical mode on the
+// terminal. steps reading a whole line keep canonical mode, and finish
+// with the title. with --max-p95, exits 1 if a screen was slower.
+//
+// stored views (.git/hci-cache) are removed before each run, so the first
+// visit of a screen renders it. first visits are reported apart from the
+// percentiles, which cover the later rounds.
+
+#include <iomanip>
+#include <iostream>
+#include <limits.h>
+#include <map>
+#include <poll.h>
+#include <pty.h>
+#include <ftw.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <git2/blob.h>
+#include "gitpp5.h"
+
+using namespace std;
+using namespace GITPP;
+
+// keys to send, and what shows the screen is there
+struct STEP {
+	char const* keys;
+	char const* screen;
+	char const* title;
+	bool line; // main reads a line, not a key
+};
+
+// menu, list config, back, edit, create variable, back, then the pages
+static STEP const script[] = {
+	{ "c", "list config", "List Config", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "e", "configure repository", "Configure Repository", false },
+	{ "a", "create variable", "maximum 30 characters", true },
+	{ "v1\n", "variable added", "Variable added", false },
+	{ "b", "main menu", "Your Git repository\n", false },
+	{ "l", "list commits", "List Commits", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "b", "list branches", "Branches", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "h", "repository health", "Repository Health", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "s", "working tree status", "Working Tree Status", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "a", "activity", "Activity", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+	{ "o", "largest blobs", "Largest Blobs", false },
+	{ "x", "main menu", "Your Git repository\n", false },
+};
+
+// one run of the program, on a pseudo terminal
+class SESSION {
+	public:
+		SESSION(string const& program, string const& dir) : _fd(-1) {
+			_t0 = chrono::steady_clock::now();
+			_pid = forkpty(&_fd, NULL, NULL, NULL);
+			if (_pid < 0) { untested();
+				throw EXCEPTION("forkpty: " + string(strerror(errno)));
+			} else if (_pid) {
+				return;
+			} else {
+			}
+
+			// newlines as they are, so titles match
+			struct termios t;
+			tcgetattr(STDIN_FILENO, &t);
+			t.c_oflag &= ~OPOST;
+			tcsetattr(STDIN_FILENO, TCSANOW, &t);
+			if (chdir(dir.c_str())) { untested();
+				_exit(127);
+			} else {
+			}
+			execl(program.c_str(), program.c_str(), (char*)NULL);
+			_exit(127);
+		}
+		~SESSION() {
+			if (_pid > 0) {
+				kill(_pid, SIGKILL);
+				waitpid(_pid, NULL, 0);
+			} else {
+			}
+			close(_fd);
+		}
+	public:
+		// seconds until the start screen is finished
+		double start() {
+			return wait("Your Git repository\n", false, _t0);
+		}
+		// send keys, seconds until the screen is finished
+		double step(STEP const& s) {
+			_out.clear();
+			auto t0 = chrono::steady_clock::now();
+			size_t n = strlen(s.keys);
+			if (write(_fd, s.keys, n) != ssize_t(n)) { untested();
+				throw EXCEPTION("write: " + string(strerror(errno)));
+			} else {
+			}
+			return wait(s.title, s.line, t0);
+		}
+		void quit() {
+			if (write(_fd, "q", 1) == 1) {
+				waitpid(_pid, NULL, 0);
+				_pid = -1;
+			} else { untested();
+			}
+		}
+	private:
+		double wait(char const* title, bool line, chrono::steady_clock::time_point t0) {
+			bool seen = false;
+			for (;;) {
+				struct pollfd p = { _fd, POLLIN, 0 };
+				int n = poll(&p, 1, seen ? 0 : 100);
+				if (n > 0) {
+					char buf[4096];
+					ssize_t r = read(_fd, buf, sizeof(buf));
+					if (r <= 0) {
+						throw EXCEPTION("program ended, waiting for " + string(title));
+					} else {
+					}
+					_out.append(buf, r);
+					seen = seen || _out.find(title) != string::npos;
+				} else {
+				}
+
+				auto t = chrono::steady_clock::now();
+				if (seen && (line || waiting())) {
+					return chrono::duration<double>(t - t0).count();
+				} else if (t - t0 > chrono::seconds(120)) {
+					throw EXCEPTION("timeout waiting for " + string(title));
+				} else if (seen) {
+					// let it get to the key
+					sched_yield();
+				} else {
+				}
+			}
+		}
+		// reading a key, canonical mode is off
+		bool waiting() const {
+			struct termios t;
+			return !tcgetattr(_fd, &t) && !(t.c_lflag & ICANON);
+		}
+	private:
+		int _fd;
+		pid_t _pid;
+		chrono::steady_clock::time_point _t0;
+		string _out;
+};
+
+// remove path and everything below it
+static void remove_all(string const& path)
+{
+	nftw(path.c_str(), [](char const* p, struct stat const*, int, struct FTW*) {
+		return remove(p);
+	}, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+// commits reachable from HEAD
+static size_t count_commits(git_repository* r)
+{
+	git_revwalk* w;
+	git_oid id;
+	size_t n = 0;
+	if (git_revwalk_new(&w, r)) { untested();
+		return 0;
+	} else if (git_revwalk_push_head(w)) {
+		// unborn
+	} else {
+		while (!git_revwalk_next(&id, w)) {
+			++n;
+		}
+	}
+	git_revwalk_free(w);
+	return n;
+}
+
+// a repository with n commits in path, unless there is one already.
+// 100 files, one changed per commit, a commit an hour, five authors, a
+// branch and a tag every 500 commits. one with another count, say from an
+// interrupted run, is made again.
+static void generate(string const& path, size_t n)
+{
+	git_repository* r;
+	if (git_repository_open(&r, path.c_str())) {
+	} else if (count_commits(r) == n) {
+		git_repository_free(r);
+		return;
+	} else {
+		git_repository_free(r);
+		remove_all(path);
+	}
+	if (git_repository_init(&r, path.c_str(), 0)) { untested();
+		throw EXCEPTION("can't create " + path);
+	} else {
+	}
+
+	static char const* const names[] = { "Ada", "Brian", "Grace", "Ken", "Linus" };
+	git_time_t t = 1500000000;
+	git_tree* tree = NULL;
+	git_commit* head = NULL;
+	for (size_t i = 0; i < n; ++i) {
+		string text = "line " + to_string(i) + "\n";
+		string file = "f" + to_string(i % 100) + ".txt";
+		string msg = "change " + file + " " + to_string(i) + "\n";
+		string name = names[i % 5];
+		git_oid blob, tid, cid;
+		memset(&cid, 0, sizeof(cid));
+		git_treebuilder* tb = NULL;
+		git_signature* sig = NULL;
+		git_commit const* parents[] = { head };
+
+		if (git_blob_create_frombuffer(&blob, r, text.data(), text.size())) { untested();
+		} else if (git_treebuilder_new(&tb, r, tree)) { untested();
+		} else if (git_treebuilder_insert(NULL, tb, file.c_str(), &blob, GIT_FILEMODE_BLOB)) { untested();
+		} else if (git_treebuilder_write(&tid, tb)) { untested();
+		} else if (git_signature_new(&sig, name.c_str(), (name + "@example.com").c_str(),
+					t + git_time_t(i) * 3600, 60)) { untested();
+		} else {
+			git_tree_free(tree);
+			tree = NULL;
+			if (git_tree_lookup(&tree, r, &tid)) { untested();
+			} else if (git_commit_create(&cid, r, "HEAD", sig, sig, NULL, msg.c_str(),
+						tree, head ? 1 : 0, parents)) { untested();
+			} else {
+			}
+		}
+		git_signature_free(sig);
+		git_treebuilder_free(tb);
+		git_commit_free(head);
+		head = NULL;
+		if (git_commit_lookup(&head, r, &cid)) { untested();
+			git_tree_free(tree);
+			git_repository_free(r);
+			throw EXCEPTION("can't commit in " + path);
+		} else {
+		}
+
+		if (i % 500 == 499) {
+			git_reference* b = NULL;
+			git_oid tag;
+			bool ok = !git_branch_create(&b, r, ("b" + to_string(i + 1)).c_str(), head, 0)
+				&& !git_tag_create_lightweight(&tag, r, ("v" + to_string(i + 1)).c_str(),
+					(git_object const*)head, 0);
+			git_reference_free(b);
+			if (!ok) { untested();
+				git_commit_free(head);
+				git_tree_free(tree);
+				git_repository_free(r);
+				throw EXCEPTION("can't branch or tag in " + path);
+			} else {
+			}
+		} else {
+		}
+	}
+	git_commit_free(head);
+	git_tree_free(tree);
+	git_repository_free(r);
+}
+
+// nearest rank
+static double percentile(vector<double> v, double p)
+{
+	sort(v.begin(), v.end());
+	size_t i = size_t(p * v.size() + .999999);
+	return v[i ? i - 1 : 0];
+}
+
+int main(int argc, char const* argv[])
+{
+	string program = "./main";
+	string dir = "/tmp/hci-replay";
+	vector<size_t> sizes = { 100, 1000, 10000 };
+	unsigned rounds = 20;
+	double max_p95 = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		string a = argv[i];
+		if (!a.compare(0, 10, "--program=")) {
+			program = a.substr(10);
+		} else if (!a.compare(0, 6, "--dir=")) {
+			dir = a.substr(6);
+		} else if (!a.compare(0, 8, "--sizes=")) {
+			sizes.clear();
+			for (char const* p = a.c_str() + 8; *p; ) {
+				char* e;
+				sizes.push_back(strtoul(p, &e, 10));
+				p = *e ? e + 1 : e;
+			}
+		} else if (!a.compare(0, 9, "--rounds=")) {
+			rounds = strtoul(a.c_str() + 9, NULL, 10);
+		} else if (!a.compare(0, 10, "--max-p95=")) {
+			max_p95 = strtod(a.c_str() + 10, NULL);
+		} else {
+			cerr << "usage: " << argv[0] << " [--program=./main] [--dir=<dir>]"
+				" [--sizes=<n>,..] [--rounds=<n>] [--max-p95=<ms>]\n";
+			return 2;
+		}
+	}
+
+	char full[PATH_MAX];
+	if (!realpath(program.c_str(), full)) {
+		cerr << program << ": " << strerror(errno) << "\n";
+		return 2;
+	} else {
+		program = full;
+	}
+	mkdir(dir.c_str(), 0777);
+	git_libgit2_init();
+
+	bool slow = false;
+	cout << "commits  screen                     n  first ms    p50 ms    p95 ms    p99 ms\n";
+	for (size_t n : sizes) {
+		string path = dir + "/" + to_string(n);
+		// per screen, in the order first seen. the first visit goes to
+		// first, the later ones to times.
+		vector<string> order;
+		map<string, double> first;
+		map<string, vector<double> > times;
+		auto add = [&](string const& s, double t) {
+			if (first.count(s)) {
+				times[s].push_back(t);
+			} else {
+				order.push_back(s);
+				first[s] = t;
+			}
+		};
+
+		try {
+			generate(path, n);
+			remove_all(path + "/.git/hci-cache");
+			SESSION s(program, path);
+			add("start", s.start());
+			for (unsigned r = 0; r < rounds; ++r) {
+				for (STEP const& st : script) {
+					add(st.screen, s.step(st));
+				}
+			}
+			s.quit();
+		}
+		catch (EXCEPTION const& e) {
+			cerr << path << ": " << e.what() << "\n";
+			return 2;
+		}
+
+		for (string const& s : order) {
+			vector<double> const& v = times[s];
+			cout << setw(7) << n << "  " << left << setw(24) << s << right << setw(4) << v.size()
+				<< fixed << setprecision(2) << setw(10) << 1e3 * first[s];
+			if (v.empty()) {
+				// start
+				cout << "\n";
+				continue;
+			} else {
+			}
+			double p95 = 1e3 * percentile(v, .95);
+			cout << setw(10) << 1e3 * percentile(v, .5)
+				<< setw(10) << p95
+				<< setw(10) << 1e3 * percentile(v, .99) << "\n";
+			slow = slow || (max_p95 > 0 && p95 > max_p95);
+		}
+	}
+	git_libgit2_shutdown();
+
+	return slow ? 1 : 0;
+}